@@ -32,6 +32,14 @@
 #include "cursor.h"
 #include "panel.h"
 #include "widgets.h"
+#include "input.h"
+#include "idle.h"
+#include "event.h"
+#include "spawner.h"
+#include "pool.h"
+#include "rules.h"
+#include "icontheme.h"
+#include "launcher.h"
 
 void change_focus(const Arg *arg)
 {
@@ -47,9 +55,9 @@ void change_focus(const Arg *arg)
 	/* found a client. show it */
 	if (client != NULL && client != focus) {
 		window_raise(client->id);
-		window_center_pointer(client->id, client->width,
+		window_center_pointer(client->x, client->y, client->width,
 				      client->height);
-		window_set_focus(client->id);
+		client_set_focus(client);
 	}
 }
 
@@ -90,7 +98,7 @@ void max_half(const Arg *arg)
 	window_move_resize(focus->id, focus->x, focus->y, focus->width,
 			   focus->height);
 	window_raise(focus->id);
-	window_center_pointer(focus->id, focus->width, focus->height);
+	window_center_pointer(focus->x, focus->y, focus->width, focus->height);
 }
 
 void delete_window(const Arg __attribute__((__unused__)) * arg)
@@ -154,7 +162,7 @@ void maximize(const Arg *arg)
 	window_move_resize(focus->id, focus->x, focus->y, focus->width,
 			   focus->height);
 	window_raise(focus->id);
-	window_center_pointer(focus->id, focus->width, focus->height);
+	window_center_pointer(focus->x, focus->y, focus->width, focus->height);
 }
 
 void hide(const Arg __attribute__((__unused__)) * arg)
@@ -172,8 +180,9 @@ void hide(const Arg __attribute__((__unused__)) * arg)
 static void raise_client(struct client *client,
 			 void __attribute__((__unused__)) * data)
 {
-	if (client->iconic == true) {
+	if (client->iconic == true && client->pool == NULL) {
 		client->iconic = false;
+		window_set_normal_state(client->id);
 		window_show(client->id);
 	}
 }
@@ -185,6 +194,14 @@ void raise_all(const Arg __attribute__((__unused__)) * arg)
 
 void start(const Arg *arg)
 {
+	/* a pre-started instance is ready */
+	if (pool_reveal(arg->com))
+		return;
+
+	/* through the launcher helper, fork ourself only as a fallback */
+	if (spawner_run(arg->com, NULL, NULL))
+		return;
+
 	if (fork())
 		return;
 
@@ -192,9 +209,15 @@ void start(const Arg *arg)
 		close(screen->root);
 
 	setsid();
+	event_unblock_signals();
 	execvp((char *)arg->com[0], (char **)arg->com);
 }
 
+void launcher(const Arg __attribute__((__unused__)) * arg)
+{
+	launcher_show();
+}
+
 void jwm_exit(const Arg __attribute__((__unused__)) * arg)
 {
 	exit(EXIT_SUCCESS);
@@ -293,6 +316,7 @@ void mouse_motion(const Arg *arg)
 	/* loop until release buttons */
 	xcb_generic_event_t *ev = NULL;
 	xcb_motion_notify_event_t *ev_motion = NULL;
+	xcb_button_release_event_t *ev_release = NULL;
 	bool button_released = false;
 
 	while (button_released == false) {
@@ -304,6 +328,8 @@ void mouse_motion(const Arg *arg)
 			switch (ev->response_type & ~0x80) {
 			case XCB_MOTION_NOTIFY:
 				ev_motion = (xcb_motion_notify_event_t *)ev;
+				cursor_track_coordinates(ev_motion->root_x,
+							 ev_motion->root_y);
 				if (arg->i == WIN_MOVE)
 					mouse_move(
 						focus,
@@ -316,6 +342,9 @@ void mouse_motion(const Arg *arg)
 						winh + ev_motion->root_y - my);
 				break;
 			case XCB_BUTTON_RELEASE:
+				ev_release = (xcb_button_release_event_t *)ev;
+				cursor_track_coordinates(ev_release->root_x,
+							 ev_release->root_y);
 				button_released = true;
 				break;
 			}
@@ -334,17 +363,30 @@ void mouse_motion(const Arg *arg)
 	panel_draw();
 }
 
-void reload_conf(const Arg __attribute__((__unused__)) * arg)
+static enum idle_status widgets_reload_task(void __attribute__((__unused__))
+					    * data)
 {
 	struct panel *panel = panel_get();
 
+	widgets_reload(panel->id, PANEL_HEIGHT);
+	panel_draw();
+
+	return IDLE_DONE;
+}
+
+void reload_conf(const Arg __attribute__((__unused__)) * arg)
+{
 	if (conf_read() == -1)
 		LOGE("Fail to read conf");
 	else {
 		log_init();
+		input_reload();
+		pool_reload();
+		rules_reload();
+		icontheme_init(global_conf.icon_theme, PANEL_ICON_SIZE);
 		monitor_set_wallpaper();
-		widgets_reload(panel->id, PANEL_HEIGHT);
-		panel_draw();
+		idle_add(widgets_reload_task, NULL);
+		panel_reload();
 	}
 }
 
@@ -361,6 +403,9 @@ void panel_toggle(const Arg __attribute__((__unused__)) * arg)
 		window_show(panel->id);
 		widgets_toggle(true);
 
+		/* not drawn while hidden */
+		panel_draw();
+
 		/* fit all client if needed */
 		client_foreach(client_fit_on_screen, NULL);
 	}
@@ -26,7 +26,7 @@ enum { FULLSCREEN_ONE_MONITOR, FULLSCREEN_ALL_MONITOR };
 
 typedef union {
 	const char **com;
-	const int8_t i;
+	int8_t i;
 } Arg;
 
 void change_focus(const Arg *arg);
@@ -36,6 +36,7 @@ void maximize(const Arg *arg);
 void hide(const Arg *arg);
 void raise_all(const Arg *arg);
 void start(const Arg *arg);
+void launcher(const Arg *arg);
 void jwm_exit(const Arg *arg);
 void mouse_motion(const Arg *arg);
 void reload_conf(const Arg *arg);
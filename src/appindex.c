@@ -0,0 +1,661 @@
+/*
+ * This file is part of the jwm distribution:
+ * https://github.com/JulienMasson/jwm
+ *
+ * Copyright (c) 2017 Julien Masson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <ctype.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+
+#include "appindex.h"
+#include "list.h"
+#include "log.h"
+#include "timer.h"
+
+/* Index of what the launcher can start: executables of $PATH and
+ * .desktop applications. Built once, rebuilt when inotify reports a
+ * change in one of the dirs, ranked by frecency saved to disk. */
+
+#define APP_DIRS_MAX 64
+#define APP_REBUILD_DELAY_MS 500
+#define APP_WATCH_MASK                                                         \
+	(IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ATTRIB       \
+	 | IN_CLOSE_WRITE | IN_DELETE_SELF)
+/* parent of a missing dir, waiting for it to appear */
+#define APP_PARENT_MASK (IN_CREATE | IN_MOVED_TO | IN_ONLYDIR | IN_MASK_ADD)
+
+struct frecency {
+	char *name;
+	uint32_t count; /* launches */
+	time_t last;    /* last launch */
+};
+
+struct app_dir {
+	char *path;
+	enum app_kind kind;
+	int wd;        /* watch of the dir, -1 while it doesn't exist */
+	int parent_wd; /* watch of its parent meanwhile */
+};
+
+static struct app_dir dirs[APP_DIRS_MAX];
+static int dirs_count = 0;
+
+static struct app **apps = NULL;
+static int apps_count = 0;
+static unsigned int apps_generation = 0;
+
+static struct list *frecency_head = NULL;
+static char frecency_path[PATH_MAX];
+
+static int inotify_fd = -1;
+static struct timer rebuild_timer;
+
+static void dirs_add(const char *path, enum app_kind kind)
+{
+	int i;
+
+	if (path[0] == '\0' || dirs_count == APP_DIRS_MAX)
+		return;
+
+	for (i = 0; i < dirs_count; i++)
+		if (strcmp(dirs[i].path, path) == 0)
+			return;
+
+	dirs[dirs_count].path = strdup(path);
+	dirs[dirs_count].kind = kind;
+	dirs[dirs_count].wd = -1;
+	dirs[dirs_count].parent_wd = -1;
+	dirs_count++;
+}
+
+static void dirs_add_list(const char *list, const char *suffix,
+			  enum app_kind kind)
+{
+	char copy[strlen(list) + 1];
+	char path[PATH_MAX];
+	char *token, *saveptr = NULL;
+
+	snprintf(copy, sizeof(copy), "%s", list);
+	for (token = strtok_r(copy, ":", &saveptr); token != NULL;
+	     token = strtok_r(NULL, ":", &saveptr)) {
+		snprintf(path, sizeof(path), "%s%s", token, suffix);
+		dirs_add(path, kind);
+	}
+}
+
+static void dirs_init(void)
+{
+	const char *env;
+	char path[PATH_MAX];
+
+	env = getenv("PATH");
+	dirs_add_list(env ? env : "/usr/local/bin:/usr/bin:/bin", "",
+		      APP_BIN);
+
+	/* XDG base directories */
+	env = getenv("XDG_DATA_HOME");
+	if (env != NULL && env[0] != '\0')
+		snprintf(path, sizeof(path), "%s", env);
+	else
+		snprintf(path, sizeof(path), "%s/.local/share",
+			 getenv("HOME") ? getenv("HOME") : "");
+	dirs_add_list(path, "/applications", APP_DESKTOP);
+
+	env = getenv("XDG_DATA_DIRS");
+	dirs_add_list(env && env[0] ? env : "/usr/local/share:/usr/share",
+		      "/applications", APP_DESKTOP);
+}
+
+static void app_add(const char *name, const char *exec, const char *icon,
+		    enum app_kind kind)
+{
+	struct app *app;
+
+	app = malloc(sizeof(struct app));
+	if (app == NULL)
+		return;
+
+	apps = realloc(apps, (apps_count + 1) * sizeof(struct app *));
+	app->name = strdup(name);
+	app->exec = strdup(exec);
+	app->icon = strdup(icon);
+	app->kind = kind;
+	app->order = apps_count;
+	app->frecency = NULL;
+	apps[apps_count++] = app;
+}
+
+static void app_free(struct app *app)
+{
+	free(app->name);
+	free(app->exec);
+	free(app->icon);
+	free(app);
+}
+
+/* drop field codes (%f, %U ...) from a desktop Exec line */
+static void desktop_exec_strip(char *exec)
+{
+	char *src = exec, *dst = exec;
+
+	while (*src != '\0') {
+		if (src[0] == '%' && src[1] != '\0') {
+			if (src[1] == '%')
+				*dst++ = '%';
+			src += 2;
+			continue;
+		}
+		*dst++ = *src++;
+	}
+	*dst = '\0';
+}
+
+static void desktop_parse(int dirfd, const char *file)
+{
+	char name[256] = "", exec[PATH_MAX] = "", icon[PATH_MAX] = "";
+	char line[PATH_MAX];
+	bool in_entry = false, hidden = false, application = true;
+	FILE *fp;
+	int fd;
+
+	fd = openat(dirfd, file, O_RDONLY | O_CLOEXEC);
+	if (fd == -1)
+		return;
+
+	fp = fdopen(fd, "r");
+	if (fp == NULL) {
+		close(fd);
+		return;
+	}
+
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		line[strcspn(line, "\n")] = '\0';
+
+		if (line[0] == '[') {
+			in_entry = strcmp(line, "[Desktop Entry]") == 0;
+			continue;
+		}
+		if (in_entry == false)
+			continue;
+
+		if (strncmp(line, "Name=", 5) == 0 && name[0] == '\0')
+			snprintf(name, sizeof(name), "%s", line + 5);
+		else if (strncmp(line, "Exec=", 5) == 0)
+			snprintf(exec, sizeof(exec), "%s", line + 5);
+		else if (strncmp(line, "Icon=", 5) == 0)
+			snprintf(icon, sizeof(icon), "%s", line + 5);
+		else if (strcmp(line, "NoDisplay=true") == 0
+			 || strcmp(line, "Hidden=true") == 0)
+			hidden = true;
+		else if (strncmp(line, "Type=", 5) == 0)
+			application = strcmp(line + 5, "Application") == 0;
+	}
+	fclose(fp);
+
+	if (hidden || !application || name[0] == '\0' || exec[0] == '\0')
+		return;
+
+	desktop_exec_strip(exec);
+	app_add(name, exec, icon, APP_DESKTOP);
+}
+
+static void dir_scan(struct app_dir *app_dir)
+{
+	struct dirent *entry;
+	struct stat st;
+	size_t len;
+	DIR *dir;
+
+	dir = opendir(app_dir->path);
+	if (dir == NULL)
+		return;
+
+	while ((entry = readdir(dir)) != NULL) {
+		if (entry->d_name[0] == '.')
+			continue;
+
+		if (app_dir->kind == APP_DESKTOP) {
+			len = strlen(entry->d_name);
+			if (len > 8
+			    && strcmp(entry->d_name + len - 8, ".desktop") == 0)
+				desktop_parse(dirfd(dir), entry->d_name);
+			continue;
+		}
+
+		/* executable regular files, symlinks followed */
+		if (fstatat(dirfd(dir), entry->d_name, &st, 0) == 0
+		    && S_ISREG(st.st_mode) && (st.st_mode & 0111))
+			app_add(entry->d_name, entry->d_name, entry->d_name,
+				APP_BIN);
+	}
+
+	closedir(dir);
+}
+
+static int app_cmp(const void *a, const void *b)
+{
+	const struct app *app_a = *(const struct app **)a;
+	const struct app *app_b = *(const struct app **)b;
+	int ret;
+
+	/* duplicates next to each other, in scan order */
+	ret = strcmp(app_a->name, app_b->name);
+	if (ret == 0)
+		ret = (int)app_a->kind - (int)app_b->kind;
+	if (ret == 0)
+		ret = app_a->order - app_b->order;
+
+	return ret;
+}
+
+static struct frecency *frecency_find(const char *name)
+{
+	struct frecency *frecency;
+	struct list *index;
+
+	for (index = frecency_head; index != NULL; index = index->next) {
+		frecency = index->data;
+
+		if (strcmp(frecency->name, name) == 0)
+			return frecency;
+	}
+
+	return NULL;
+}
+
+static void frecency_load(void)
+{
+	struct frecency *frecency;
+	char name[PATH_MAX];
+	unsigned int count;
+	long last;
+	FILE *fp;
+
+	fp = fopen(frecency_path, "r");
+	if (fp == NULL)
+		return;
+
+	/* count last name */
+	while (fscanf(fp, "%u %ld %[^\n]", &count, &last, name) == 3) {
+		frecency = malloc(sizeof(struct frecency));
+		if (frecency == NULL)
+			break;
+
+		frecency->name = strdup(name);
+		frecency->count = count;
+		frecency->last = last;
+		if (list_add(&frecency_head, frecency) == NULL) {
+			free(frecency->name);
+			free(frecency);
+		}
+	}
+
+	fclose(fp);
+}
+
+static void frecency_save(void)
+{
+	struct frecency *frecency;
+	struct list *index;
+	FILE *fp;
+
+	if (frecency_path[0] == '\0')
+		return;
+
+	fp = fopen(frecency_path, "w");
+	if (fp == NULL) {
+		LOGW("Cannot save launcher history to %s", frecency_path);
+		return;
+	}
+
+	for (index = frecency_head; index != NULL; index = index->next) {
+		frecency = index->data;
+		fprintf(fp, "%u %ld %s\n", frecency->count,
+			(long)frecency->last, frecency->name);
+	}
+
+	fclose(fp);
+}
+
+/* launches weighted by how recent the last one is */
+static uint64_t frecency_score(struct frecency *frecency, time_t now)
+{
+	time_t age;
+
+	if (frecency == NULL)
+		return 0;
+
+	age = now - frecency->last;
+	if (age < 3600)
+		return frecency->count * 8;
+	else if (age < 24 * 3600)
+		return frecency->count * 4;
+	else if (age < 7 * 24 * 3600)
+		return frecency->count * 2;
+
+	return frecency->count;
+}
+
+static void apps_clear(void)
+{
+	int i;
+
+	for (i = 0; i < apps_count; i++)
+		app_free(apps[i]);
+	free(apps);
+	apps = NULL;
+	apps_count = 0;
+}
+
+void appindex_rebuild(void)
+{
+	int i, count;
+
+	apps_clear();
+	apps_generation++;
+
+	for (i = 0; i < dirs_count; i++)
+		dir_scan(&dirs[i]);
+
+	/* sorted by name, ties in scan order so the first dir wins on
+	 * duplicates like $PATH does */
+	qsort(apps, apps_count, sizeof(struct app *), app_cmp);
+	count = 0;
+	for (i = 0; i < apps_count; i++) {
+		if (count > 0 && apps[i]->kind == apps[count - 1]->kind
+		    && strcmp(apps[i]->name, apps[count - 1]->name) == 0) {
+			app_free(apps[i]);
+			continue;
+		}
+		apps[count++] = apps[i];
+	}
+	apps_count = count;
+
+	for (i = 0; i < apps_count; i++)
+		apps[i]->frecency = frecency_find(apps[i]->name);
+
+	LOGD("Launcher index: %d applications", apps_count);
+}
+
+unsigned int appindex_generation(void)
+{
+	return apps_generation;
+}
+
+static void dir_watch(struct app_dir *app_dir)
+{
+	char parent[PATH_MAX];
+	char *slash;
+
+	app_dir->wd = inotify_add_watch(inotify_fd, app_dir->path,
+					APP_WATCH_MASK);
+	if (app_dir->wd != -1 || app_dir->parent_wd != -1)
+		return;
+
+	/* watch the parent to know when it's created */
+	snprintf(parent, sizeof(parent), "%s", app_dir->path);
+	slash = strrchr(parent, '/');
+	if (slash == NULL || slash == parent)
+		return;
+	*slash = '\0';
+
+	app_dir->parent_wd =
+		inotify_add_watch(inotify_fd, parent, APP_PARENT_MASK);
+
+	/* created before the parent was watched */
+	if (app_dir->parent_wd != -1)
+		app_dir->wd = inotify_add_watch(inotify_fd, app_dir->path,
+						APP_WATCH_MASK);
+}
+
+/* watch the dirs that exist now and are not watched yet */
+static void dirs_watch(void)
+{
+	int i;
+
+	if (inotify_fd == -1)
+		return;
+
+	for (i = 0; i < dirs_count; i++)
+		if (dirs[i].wd == -1)
+			dir_watch(&dirs[i]);
+}
+
+/* true if this event may change the index */
+static bool dirs_event(struct inotify_event *event)
+{
+	const char *name;
+	bool changed = false;
+	int i;
+
+	/* queue overflow, events were lost */
+	if (event->wd == -1)
+		return true;
+
+	for (i = 0; i < dirs_count; i++) {
+		if (event->wd == dirs[i].wd) {
+			/* removed or moved away, watched again later */
+			if (event->mask & (IN_DELETE_SELF | IN_IGNORED))
+				dirs[i].wd = -1;
+			changed = true;
+		} else if (event->wd == dirs[i].parent_wd) {
+			if (event->mask & IN_IGNORED) {
+				dirs[i].parent_wd = -1;
+				continue;
+			}
+
+			/* another entry of the parent */
+			name = strrchr(dirs[i].path, '/') + 1;
+			if (dirs[i].wd == -1 && event->len > 0
+			    && strcmp(event->name, name) == 0)
+				changed = true;
+		}
+	}
+
+	return changed;
+}
+
+static void appindex_rebuild_timer(void __attribute__((__unused__)) * data)
+{
+	dirs_watch();
+	appindex_rebuild();
+}
+
+bool appindex_init(const char *frecency_file)
+{
+	dirs_init();
+
+	snprintf(frecency_path, sizeof(frecency_path), "%s",
+		 frecency_file ? frecency_file : "");
+	frecency_load();
+
+	appindex_rebuild();
+
+	/* keep the index current */
+	timer_setup(&rebuild_timer, appindex_rebuild_timer, NULL);
+	inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (inotify_fd == -1) {
+		LOGW("No inotify, launcher index won't be updated");
+		return true;
+	}
+
+	dirs_watch();
+
+	return true;
+}
+
+int appindex_get_fd(void)
+{
+	return inotify_fd;
+}
+
+void appindex_event(void)
+{
+	char buf[4096]
+		__attribute__((aligned(__alignof__(struct inotify_event))));
+	struct inotify_event *event;
+	bool changed = false;
+	ssize_t len;
+	char *ptr;
+
+	while ((len = read(inotify_fd, buf, sizeof(buf))) > 0) {
+		for (ptr = buf; ptr < buf + len;
+		     ptr += sizeof(struct inotify_event) + event->len) {
+			event = (struct inotify_event *)ptr;
+			if (dirs_event(event) == true)
+				changed = true;
+		}
+	}
+
+	if (changed == false)
+		return;
+
+	/* a package install touches many files, rebuild once it's over */
+	timer_add(&rebuild_timer, APP_REBUILD_DELAY_MS, 0);
+}
+
+static bool contains_nocase(const char *name, const char *query, size_t len)
+{
+	for (; *name != '\0'; name++)
+		if (strncasecmp(name, query, len) == 0)
+			return true;
+
+	return false;
+}
+
+enum app_match appindex_match(const char *query, const char *name)
+{
+	const char *q = query, *n;
+	size_t len = strlen(query);
+
+	if (len == 0 || strncasecmp(name, query, len) == 0)
+		return APP_MATCH_PREFIX;
+
+	if (contains_nocase(name, query, len))
+		return APP_MATCH_SUBSTRING;
+
+	for (n = name; *n != '\0' && *q != '\0'; n++)
+		if (tolower((unsigned char)*n) == tolower((unsigned char)*q))
+			q++;
+
+	return *q == '\0' ? APP_MATCH_FUZZY : APP_MATCH_NONE;
+}
+
+struct app_result {
+	struct app *app;
+	enum app_match match;
+	uint64_t score;
+};
+
+static bool result_before(struct app_result *a, struct app_result *b)
+{
+	if (a->match != b->match)
+		return a->match > b->match;
+	if (a->score != b->score)
+		return a->score > b->score;
+
+	/* shorter names first, apps are already sorted by name */
+	return strlen(a->app->name) < strlen(b->app->name);
+}
+
+int appindex_query(const char *query, struct app **results, int max)
+{
+	struct app_result best[max > 0 ? max : 1], cur;
+	time_t now = time(NULL);
+	int i, j, count = 0;
+
+	if (max <= 0)
+		return 0;
+
+	for (i = 0; i < apps_count; i++) {
+		cur.match = appindex_match(query, apps[i]->name);
+		if (cur.match == APP_MATCH_NONE)
+			continue;
+
+		cur.app = apps[i];
+		cur.score = frecency_score(apps[i]->frecency, now);
+
+		/* keep the best ones sorted, insertion in a small array */
+		if (count == max && !result_before(&cur, &best[count - 1]))
+			continue;
+		if (count < max)
+			count++;
+		for (j = count - 1; j > 0 && result_before(&cur, &best[j - 1]);
+		     j--)
+			best[j] = best[j - 1];
+		best[j] = cur;
+	}
+
+	for (i = 0; i < count; i++)
+		results[i] = best[i].app;
+
+	return count;
+}
+
+void appindex_launched(struct app *app)
+{
+	struct frecency *frecency = app->frecency;
+
+	if (frecency == NULL) {
+		frecency = malloc(sizeof(struct frecency));
+		if (frecency == NULL)
+			return;
+
+		frecency->name = strdup(app->name);
+		frecency->count = 0;
+		if (list_add(&frecency_head, frecency) == NULL) {
+			free(frecency->name);
+			free(frecency);
+			return;
+		}
+		app->frecency = frecency;
+	}
+
+	frecency->count++;
+	frecency->last = time(NULL);
+	frecency_save();
+}
+
+void appindex_exit(void)
+{
+	struct frecency *frecency;
+	int i;
+
+	timer_cancel(&rebuild_timer);
+	if (inotify_fd != -1)
+		close(inotify_fd);
+	inotify_fd = -1;
+
+	apps_clear();
+
+	while (frecency_head != NULL) {
+		frecency = frecency_head->data;
+		free(frecency->name);
+		list_remove(&frecency_head, frecency_head);
+	}
+
+	for (i = 0; i < dirs_count; i++)
+		free(dirs[i].path);
+	dirs_count = 0;
+}
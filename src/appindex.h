@@ -0,0 +1,65 @@
+/*
+ * This file is part of the jwm distribution:
+ * https://github.com/JulienMasson/jwm
+ *
+ * Copyright (c) 2017 Julien Masson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef APPINDEX_H
+#define APPINDEX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+enum app_kind { APP_BIN, APP_DESKTOP };
+
+enum app_match {
+	APP_MATCH_NONE,
+	APP_MATCH_FUZZY,     /* query chars in order */
+	APP_MATCH_SUBSTRING, /* query somewhere in the name */
+	APP_MATCH_PREFIX     /* name starts with the query */
+};
+
+struct frecency;
+
+struct app {
+	char *name; /* shown and matched */
+	char *exec; /* command line */
+	char *icon; /* icon name or absolute path */
+	enum app_kind kind;
+	int order;  /* scan position, earlier dirs first */
+	struct frecency *frecency;
+};
+
+bool appindex_init(const char *frecency_file);
+
+int appindex_get_fd(void);
+
+void appindex_event(void);
+
+void appindex_rebuild(void);
+
+/* changes on each rebuild, which frees the apps of the last queries */
+unsigned int appindex_generation(void);
+
+enum app_match appindex_match(const char *query, const char *name);
+
+int appindex_query(const char *query, struct app **results, int max);
+
+void appindex_launched(struct app *app);
+
+void appindex_exit(void);
+
+#endif
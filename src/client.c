@@ -17,6 +17,7 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <string.h>
 #include <xcb/xcb.h>
 #include <xcb/xcb_icccm.h>
 
@@ -29,6 +30,12 @@
 #include "input.h"
 #include "panel.h"
 #include "utils.h"
+#include "cursor.h"
+#include "ewmh.h"
+#include "idle.h"
+#include "pool.h"
+#include "rules.h"
+#include "log.h"
 
 /* list of all client windows */
 struct list *clients_head;
@@ -76,18 +83,57 @@ static struct client *client_create(xcb_window_t win)
 	client->iconic = false;
 	client->maxed = false;
 	client->monitor = NULL;
+	client->pool = NULL;
+	client->icon = NULL;
+	client->icon_dirty = true;
 	client->index = index;
 
 	return client;
 }
 
+static enum idle_status client_list_task(void __attribute__((__unused__))
+					 * data)
+{
+	struct client *client;
+	xcb_window_t *list;
+	struct list *index;
+	uint32_t len = 0;
+
+	for (index = clients_head; index != NULL; index = index->next)
+		len++;
+
+	list = malloc((len + 1) * sizeof(xcb_window_t));
+	if (list == NULL)
+		return IDLE_DONE;
+
+	/* hidden pool instances are not advertised */
+	len = 0;
+	for (index = clients_head; index != NULL; index = index->next) {
+		client = index->data;
+		if (client->pool == NULL)
+			list[len++] = client->id;
+	}
+
+	ewmh_set_client_list(list, len);
+	free(list);
+
+	return IDLE_DONE;
+}
+
 static void client_remove(struct client *client)
 {
 	if (client == NULL)
 		return;
 
+	if (client->pool != NULL)
+		pool_release(client);
+
+	if (client->icon != NULL)
+		cairo_surface_destroy(client->icon);
+
 	/* remove from clients_head list */
 	list_remove(&clients_head, client->index);
+	idle_add(client_list_task, NULL);
 	panel_draw();
 }
 
@@ -110,6 +156,21 @@ struct client *client_get_focus(void)
 	return focus;
 }
 
+struct client *client_get_pooled(struct pool *pool)
+{
+	struct client *client;
+	struct list *index;
+
+	for (index = clients_head; index != NULL; index = index->next) {
+		client = index->data;
+
+		if (client->pool == pool)
+			return client;
+	}
+
+	return NULL;
+}
+
 struct client *client_get_first(void)
 {
 	struct client *client = NULL;
@@ -291,12 +352,115 @@ void client_monitor_reassign(struct monitor *old, struct monitor *new)
 
 void client_set_focus(struct client *client)
 {
-	if (client != NULL) {
-		window_set_focus(client->id);
-		input_grab_buttons(client->id);
-		focus = client;
-		panel_draw();
+	struct client *old = focus;
+
+	if (client == NULL)
+		return;
+
+	/* the focus may have been taken from us, always set it again */
+	window_set_focus(client->id);
+	focus = client;
+
+	/* hot path: only the two task buttons change */
+	if (client != old)
+		panel_draw_focus(old, client);
+}
+
+static bool client_apply_rules(struct client *client)
+{
+	char class[256], instance[256], title[256];
+	const char *props[RULE_LAST];
+	const struct conf_rule *rule;
+	struct monitor *mon = NULL;
+	int16_t x, y;
+
+	if (rules_loaded() == false)
+		return false;
+
+	memset(class, '\0', 256);
+	memset(instance, '\0', 256);
+	memset(title, '\0', 256);
+	window_get_class(client->id, class, instance, 256);
+	window_get_name(client->id, title, 256);
+
+	props[RULE_CLASS] = class;
+	props[RULE_INSTANCE] = instance;
+	props[RULE_TITLE] = title;
+	props[RULE_TYPE] = window_get_type(client->id);
+
+	rule = rules_match(props);
+	if (rule == NULL)
+		return false;
+
+	if (rule->width != 0) {
+		client->width = rule->width;
+		client->height = rule->height;
+	}
+
+	if (rule->monitor != NULL) {
+		mon = monitor_find(rule->monitor);
+		if (mon == NULL)
+			LOGW("Rule monitor %s not found", rule->monitor);
+	}
+
+	/* size only, placed like any other window */
+	if (mon == NULL && rule->position == false) {
+		window_resize(client->id, client->width, client->height);
+		return false;
+	}
+
+	if (mon == NULL) {
+		cursor_get_coordinates(&x, &y);
+		mon = monitor_find_by_coord(x, y);
+	}
+
+	if (rule->position) {
+		client->x = mon->x + rule->x;
+		client->y = mon->y + rule->y;
+	} else {
+		client->x = mon->x + (mon->width - client->width) / 2;
+		client->y = mon->y + (mon->height - client->height) / 2;
+	}
+
+	/* configured once, before the window is ever visible */
+	window_move_resize(client->id, client->x, client->y, client->width,
+			   client->height);
+	return true;
+}
+
+static void client_show(struct client *client)
+{
+	/* rules first, if coord map not specified use pointer coordinate */
+	if (client_apply_rules(client) == false
+	    && window_hint_us_position(client->id) == false) {
+		cursor_get_coordinates(&client->x, &client->y);
+		client->x -= client->width / 2;
+		client->y -= client->height / 2;
+		window_move(client->id, client->x, client->y);
 	}
+
+	/* find the physical output this window will be on */
+	client->monitor = monitor_find_by_coord(client->x, client->y);
+
+	/* show client on screen */
+	client_fit_on_screen(client, NULL);
+	window_set_normal_state(client->id);
+	window_show(client->id);
+	window_center_pointer(client->x, client->y, client->width,
+			      client->height);
+
+	/* the crossing from our warp is ignored, focus it ourself */
+	client_set_focus(client);
+
+	/* advertise it once the burst of map events is handled */
+	idle_add(client_list_task, NULL);
+}
+
+void client_reveal(struct client *client)
+{
+	/* shown as if it was just mapped */
+	client->iconic = false;
+	client_show(client);
 }
 
 void client_map_request(xcb_map_request_event_t *ev)
@@ -312,8 +476,9 @@ void client_map_request(xcb_map_request_event_t *ev)
 	if (window_check_type(*win) == false)
 		return;
 
-	/* setup new window */
+	/* setup new window, buttons are grabbed once for its lifetime */
 	window_setup(*win);
+	input_grab_buttons(*win);
 
 	/* new client */
 	client = client_create(*win);
@@ -329,24 +494,13 @@ void client_map_request(xcb_map_request_event_t *ev)
 			       &client->max_height, &client->min_width,
 			       &client->min_height);
 
-	/* if coord map not specified, use pointer coordinate */
-	if (window_hint_us_position(client->id) == false) {
-		if (window_get_pointer(&screen->root, &client->x, &client->y)
-		    == false)
-			client->x = client->y = 0;
-
-		client->x -= client->width / 2;
-		client->y -= client->height / 2;
-		window_move(client->id, client->x, client->y);
+	/* pre-started instance of a pool, keep it hidden */
+	if (pool_capture(client)) {
+		client->iconic = true;
+		return;
 	}
 
-	/* find the physical output this window will be on */
-	client->monitor = monitor_find_by_coord(client->x, client->y);
-
-	/* show client on screen */
-	client_fit_on_screen(client, NULL);
-	window_show(client->id);
-	window_center_pointer(client->id, client->width, client->height);
+	client_show(client);
 }
 
 void client_configure_request(xcb_configure_request_event_t *ev)
@@ -439,7 +593,7 @@ void client_message(xcb_client_message_event_t *ev)
 	     && ev->data.data32[0] == XCB_ICCCM_WM_STATE_ICONIC)
 	    || ev->type == ewmh->_NET_ACTIVE_WINDOW) {
 		client = client_find_by_win(&ev->window);
-		if (client == NULL)
+		if (client == NULL || client->pool != NULL)
 			return;
 
 		if (client->iconic == false) {
@@ -451,7 +605,28 @@ void client_message(xcb_client_message_event_t *ev)
 		}
 
 		client->iconic = false;
+		window_set_normal_state(client->id);
 		window_show(client->id);
 		client_set_focus(client);
 	}
 }
+
+void client_property(xcb_property_notify_event_t *ev)
+{
+	struct client *client;
+
+	if (ev->atom != ewmh->_NET_WM_ICON && ev->atom != ewmh->_NET_WM_NAME
+	    && ev->atom != XCB_ATOM_WM_NAME)
+		return;
+
+	client = client_find_by_win(&ev->window);
+	if (client == NULL)
+		return;
+
+	/* fetched again on the next repaint */
+	if (ev->atom == ewmh->_NET_WM_ICON)
+		client->icon_dirty = true;
+
+	/* only the button of this client */
+	panel_draw_client(client);
+}
@@ -21,10 +21,13 @@
 #define CLIENT_H
 
 #include <stdbool.h>
+#include <cairo/cairo.h>
 
 #include "monitor.h"
 #include "list.h"
 
+struct pool;
+
 enum client_search_t { CLIENT_NEXT, CLIENT_PREVIOUS };
 
 struct sizepos {
@@ -40,6 +43,9 @@ struct client {
 	uint16_t max_width, max_height, min_width, min_height;
 	bool maxed, iconic;
 	struct monitor *monitor; // The physical output this window is on.
+	struct pool *pool;       // Pool keeping us hidden until revealed.
+	cairo_surface_t *icon;   // Panel icon, fetched again if icon_dirty.
+	bool icon_dirty;
 	struct list *index;      // Pointer to our place in global windows list.
 };
 
@@ -47,6 +53,7 @@ struct client {
 void client_foreach(void (*func)(struct client *client, void *data),
 		    void *data);
 struct client *client_get_focus(void);
+struct client *client_get_pooled(struct pool *pool);
 struct client *client_get_first(void);
 struct client *client_get_circular(struct client *start,
 				   enum client_search_t direction);
@@ -54,6 +61,9 @@ struct client *client_get_circular(struct client *start,
 /* set focus */
 void client_set_focus(struct client *client);
 
+/* show a hidden pool instance */
+void client_reveal(struct client *client);
+
 /* check client parameters */
 void client_check_monitor(struct client *client);
 void client_fit_on_screen(struct client *client, void *data);
@@ -69,5 +79,6 @@ void client_destroy(xcb_destroy_notify_event_t *ev);
 void client_enter(xcb_enter_notify_event_t *ev);
 void client_unmap(xcb_unmap_notify_event_t *ev);
 void client_message(xcb_client_message_event_t *ev);
+void client_property(xcb_property_notify_event_t *ev);
 
 #endif
@@ -31,12 +31,219 @@
 struct conf global_conf;
 static char *conf_path;
 
+static void add_binding(struct list **head, char *value)
+{
+	size_t len = strlen(value) + 1;
+	char combo[len], action[len];
+	struct conf_binding *binding;
+	int offset = 0;
+
+	memset(combo, '\0', len);
+	memset(action, '\0', len);
+
+	/* combo and action are mandatory, the rest is the argument */
+	if (sscanf(value, "%s %s %n", combo, action, &offset) < 2) {
+		LOGW("Invalid binding: %s", value);
+		return;
+	}
+
+	binding = malloc(sizeof(struct conf_binding));
+	if (binding == NULL)
+		return;
+
+	binding->combo = strdup(combo);
+	binding->action = strdup(action);
+	binding->arg = strdup(value + offset);
+
+	if (list_add(head, binding) == NULL) {
+		free(binding->combo);
+		free(binding->action);
+		free(binding->arg);
+		free(binding);
+	}
+}
+
+static void clear_bindings(struct list **head)
+{
+	struct conf_binding *binding;
+
+	while (*head != NULL) {
+		binding = (*head)->data;
+		free(binding->combo);
+		free(binding->action);
+		free(binding->arg);
+		list_remove(head, *head);
+	}
+}
+
+static void add_pool(char *value)
+{
+	struct conf_pool *pool;
+	int size, offset = 0;
+
+	/* size then the command line */
+	if (sscanf(value, "%d %n", &size, &offset) < 1 || size <= 0
+	    || value[offset] == '\0') {
+		LOGW("Invalid pool: %s", value);
+		return;
+	}
+
+	pool = malloc(sizeof(struct conf_pool));
+	if (pool == NULL)
+		return;
+
+	pool->size = size;
+	pool->command = strdup(value + offset);
+
+	if (list_add(&global_conf.pools, pool) == NULL) {
+		free(pool->command);
+		free(pool);
+	}
+}
+
+static void clear_pools(struct list **head)
+{
+	struct conf_pool *pool;
+
+	while (*head != NULL) {
+		pool = (*head)->data;
+		free(pool->command);
+		list_remove(head, *head);
+	}
+}
+
+static const char *rule_fields[RULE_LAST] = {
+	[RULE_CLASS] = "class",
+	[RULE_INSTANCE] = "instance",
+	[RULE_TITLE] = "title",
+	[RULE_TYPE] = "type",
+};
+
+static void free_rule(struct conf_rule *rule)
+{
+	int i;
+
+	for (i = 0; i < RULE_LAST; i++)
+		free(rule->match[i]);
+	free(rule->monitor);
+}
+
+static bool parse_rule_token(struct conf_rule *rule, char *token)
+{
+	char *value = strchr(token, '=');
+	int i;
+
+	if (value == NULL || value[1] == '\0')
+		return false;
+	*value++ = '\0';
+
+	for (i = 0; i < RULE_LAST; i++) {
+		if (strcmp(token, rule_fields[i]) == 0) {
+			free(rule->match[i]);
+			rule->match[i] = strdup(value);
+			return true;
+		}
+	}
+
+	if (strcmp(token, "monitor") == 0) {
+		free(rule->monitor);
+		rule->monitor = strdup(value);
+		return true;
+	}
+
+	if (strcmp(token, "size") == 0) {
+		if (sscanf(value, "%hux%hu", &rule->width, &rule->height) != 2)
+			return false;
+		return rule->width > 0 && rule->height > 0;
+	}
+
+	if (strcmp(token, "position") == 0) {
+		rule->position =
+			sscanf(value, "%hd,%hd", &rule->x, &rule->y) == 2;
+		return rule->position;
+	}
+
+	return false;
+}
+
+static void add_rule(char *value)
+{
+	size_t len = strlen(value) + 1;
+	char tokens[len], *token, *saveptr;
+	struct conf_rule *rule;
+	bool valid = true, match = false;
+	int i;
+
+	rule = calloc(1, sizeof(struct conf_rule));
+	if (rule == NULL)
+		return;
+
+	/* space separated <property>=<value> */
+	memcpy(tokens, value, len);
+	for (token = strtok_r(tokens, " \t", &saveptr);
+	     token != NULL && valid; token = strtok_r(NULL, " \t", &saveptr))
+		valid = parse_rule_token(rule, token);
+
+	for (i = 0; i < RULE_LAST; i++)
+		match |= (rule->match[i] != NULL);
+
+	/* at least one matcher and something to apply */
+	if (!valid || !match
+	    || (!rule->monitor && !rule->width && !rule->position)) {
+		LOGW("Invalid rule: %s", value);
+		free_rule(rule);
+		free(rule);
+		return;
+	}
+
+	if (list_add(&global_conf.rules, rule) == NULL) {
+		free_rule(rule);
+		free(rule);
+	}
+}
+
+static void clear_rules(struct list **head)
+{
+	while (*head != NULL) {
+		free_rule((*head)->data);
+		list_remove(head, *head);
+	}
+}
+
 static void parse_line(char *line, ssize_t nread)
 {
 	char key[nread], value[nread];
 	static char log_file[PATH_MAX];
 	static char wallpaper[PATH_MAX];
 	static char widgets[PATH_MAX];
+	static char icon_theme[NAME_MAX];
+	static char clock_format[256];
+
+	memset(key, '\0', nread);
+	memset(value, '\0', nread);
+
+	/* bindings take the rest of the line */
+	if (sscanf(line, "%[^=]=%[^\n]", key, value) == 2) {
+		if (strncmp(key, "key", nread) == 0) {
+			add_binding(&global_conf.keys, value);
+			return;
+		} else if (strncmp(key, "button", nread) == 0) {
+			add_binding(&global_conf.buttons, value);
+			return;
+		} else if (strncmp(key, "pool", nread) == 0) {
+			add_pool(value);
+			return;
+		} else if (strncmp(key, "rule", nread) == 0) {
+			add_rule(value);
+			return;
+		} else if (strncmp(key, "clock_format", nread) == 0) {
+			memset(clock_format, '\0', sizeof(clock_format));
+			snprintf(clock_format, sizeof(clock_format), "%s",
+				 value);
+			global_conf.clock_format = clock_format;
+			return;
+		}
+	}
 
 	memset(key, '\0', nread);
 	memset(value, '\0', nread);
@@ -57,6 +264,10 @@ static void parse_line(char *line, ssize_t nread)
 			memset(widgets, '\0', PATH_MAX);
 			snprintf(widgets, PATH_MAX, "%s", value);
 			global_conf.widgets = widgets;
+		} else if (strncmp(key, "icon_theme", nread) == 0) {
+			memset(icon_theme, '\0', NAME_MAX);
+			snprintf(icon_theme, NAME_MAX, "%s", value);
+			global_conf.icon_theme = icon_theme;
 		}
 	}
 }
@@ -74,6 +285,12 @@ int conf_read(void)
 		return -1;
 	}
 
+	/* bindings are read again from scratch */
+	clear_bindings(&global_conf.keys);
+	clear_bindings(&global_conf.buttons);
+	clear_pools(&global_conf.pools);
+	clear_rules(&global_conf.rules);
+
 	while ((nread = getline(&line, &len, fp)) != -1)
 		parse_line(line, nread);
 
@@ -103,6 +320,12 @@ void conf_init(char *path)
 	global_conf.log_file = NULL;
 	global_conf.wallpaper = DEFAULT_WALLPAPER;
 	global_conf.widgets = NULL;
+	global_conf.icon_theme = DEFAULT_ICON_THEME;
+	global_conf.clock_format = DEFAULT_CLOCK_FORMAT;
+	clear_bindings(&global_conf.keys);
+	clear_bindings(&global_conf.buttons);
+	clear_pools(&global_conf.pools);
+	clear_rules(&global_conf.rules);
 
 	/* read config */
 	conf_read();
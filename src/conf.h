@@ -20,11 +20,47 @@
 #ifndef CONF_H
 #define CONF_H
 
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "list.h"
+
+#define DEFAULT_ICON_THEME "hicolor"
+#define DEFAULT_CLOCK_FORMAT "%R  -  %d %b"
+
+struct conf_binding {
+	char *combo;  /* modifiers and key/button, ex: Mod+Shift+e */
+	char *action; /* action name, ex: start */
+	char *arg;    /* action argument, may be empty */
+};
+
+struct conf_pool {
+	int size;      /* hidden instances kept ready */
+	char *command; /* command line of the start binding */
+};
+
+/* window properties a rule can match */
+enum rule_field { RULE_CLASS, RULE_INSTANCE, RULE_TITLE, RULE_TYPE, RULE_LAST };
+
+struct conf_rule {
+	char *match[RULE_LAST]; /* extended regex per property, may be NULL */
+	char *monitor;          /* output name or number, may be NULL */
+	int16_t x, y;           /* position in the monitor */
+	uint16_t width, height; /* size, 0 if not set */
+	bool position;          /* x and y are set */
+};
+
 struct conf {
 	int log_level;
 	char *log_file;
 	char *wallpaper;
 	char *widgets;
+	char *icon_theme;
+	char *clock_format;
+	struct list *keys;
+	struct list *buttons;
+	struct list *pools;
+	struct list *rules;
 };
 
 extern struct conf global_conf;
@@ -21,8 +21,6 @@
 #define CONFIG_H
 
 /* Programs */
-static const char *rofi_run[] = {"rofi",   "-show",       "run",
-				 "-theme", "flat-orange", NULL};
 static const char *urxvt[] = {"urxvt", NULL};
 static const char *emacs[] = {"emacs", NULL};
 static const char *volume_up[] = {"amixer", "set", "Master", "4%+", NULL};
@@ -53,7 +51,7 @@ static key keys[] = {
 	/* Toggle panel */
 	{MOD, XK_p, panel_toggle, {}},
 	/* Programs */
-	{MOD, XK_d, start, {.com = rofi_run}},
+	{MOD, XK_d, launcher, {}},
 	{MOD, XK_Return, start, {.com = urxvt}},
 	{MOD | SHIFT, XK_e, start, {.com = emacs}},
 	{MOD, XK_i, start, {.com = volume_up}},
@@ -18,6 +18,8 @@
  */
 
 #include <string.h>
+#include <stdbool.h>
+#include <stdlib.h>
 
 #include "global.h"
 #include "cursor.h"
@@ -31,6 +33,14 @@ static uint16_t glyphs[LAST] = {68, 52, 120};
 static xcb_cursor_t cursors_id[LAST] = {0, 0, 0};
 static int current_cursor;
 
+/* last known pointer position on the root window, stale once it
+ * leaves the root for a window we get no crossing events from */
+struct pointer_t {
+	int16_t x, y;
+	bool stale;
+};
+static struct pointer_t pointer = {0, 0, true};
+
 void cursor_init(void)
 {
 	int i;
@@ -66,15 +76,32 @@ void cursor_set(xcb_window_t window, enum cursor_t cursor)
 void cursor_get_coordinates(int16_t *mx, int16_t *my)
 {
 	xcb_query_pointer_cookie_t cookie_query;
-	xcb_query_pointer_reply_t *pointer;
-
-	cookie_query = xcb_query_pointer(conn, screen->root);
-	pointer = xcb_query_pointer_reply(conn, cookie_query, 0);
-	if (pointer) {
-		*mx = pointer->root_x;
-		*my = pointer->root_y;
-		free(pointer);
+	xcb_query_pointer_reply_t *reply;
+
+	/* only ask the server when we don't know where the pointer is */
+	if (pointer.stale == true) {
+		cookie_query = xcb_query_pointer(conn, screen->root);
+		reply = xcb_query_pointer_reply(conn, cookie_query, 0);
+		if (reply) {
+			cursor_track_coordinates(reply->root_x, reply->root_y);
+			free(reply);
+		}
 	}
+
+	*mx = pointer.x;
+	*my = pointer.y;
+}
+
+void cursor_track_coordinates(int16_t mx, int16_t my)
+{
+	pointer.x = mx;
+	pointer.y = my;
+	pointer.stale = false;
+}
+
+void cursor_invalidate_coordinates(void)
+{
+	pointer.stale = true;
 }
 
 void cursor_grab(void)
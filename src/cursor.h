@@ -30,6 +30,10 @@ void cursor_set(xcb_window_t window, enum cursor_t cursor);
 
 void cursor_get_coordinates(int16_t *mx, int16_t *my);
 
+void cursor_track_coordinates(int16_t mx, int16_t my);
+
+void cursor_invalidate_coordinates(void);
+
 void cursor_grab(void);
 
 void cursor_ungrab(void);
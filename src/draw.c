@@ -18,9 +18,145 @@
  */
 
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 #include <math.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/stat.h>
 
 #include "draw.h"
+#include "list.h"
+#include "metrics.h"
+
+/* shaped texts of a draw_t, slot picked by the hash of the text */
+#define TEXT_CACHE_SIZE 64
+
+struct text_entry {
+	uint32_t hash;
+	char *text;
+	size_t len;
+	PangoLayout *layout;
+	int width, height;      /* measured without wrapping */
+	int area_w, area_h;     /* geometry set by the last draw_text() */
+};
+
+/* decoded icons, scaled once to the size they are drawn at */
+#define ICON_CACHE_MAX 64
+
+struct icon_entry {
+	char *path;
+	int size;
+	time_t mtime;
+	cairo_surface_t *surface;
+};
+
+static struct list *icons_head = NULL;
+static int icons_count = 0;
+
+/* widgets draw icons from their own thread */
+static pthread_mutex_t icons_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/* one pango context per thread shaping text (the main one and the
+ * widgets one), shared by its draw_t, fonts interned by name */
+struct font_entry {
+	char *name;
+	PangoFontDescription *desc;
+	int refs;
+};
+
+static pthread_key_t context_key;
+static pthread_once_t context_once = PTHREAD_ONCE_INIT;
+static struct list *fonts_head = NULL;
+static pthread_mutex_t fonts_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void context_key_create(void)
+{
+	/* released when the thread exits or is canceled */
+	pthread_key_create(&context_key, g_object_unref);
+}
+
+static PangoContext *context_get(cairo_t *cr)
+{
+	PangoContext *context;
+	PangoFontMap *font_map;
+
+	pthread_once(&context_once, context_key_create);
+
+	context = pthread_getspecific(context_key);
+	if (context == NULL) {
+		font_map = pango_cairo_font_map_get_default();
+		context = pango_font_map_create_context(font_map);
+
+		/* font options set once, the same for all our surfaces,
+		 * changing them would invalidate every cached layout */
+		pango_cairo_update_context(cr, context);
+		pthread_setspecific(context_key, context);
+		metrics_inc(METRIC_TEXT_CONTEXT);
+	}
+
+	return context;
+}
+
+static PangoFontDescription *font_get(const char *name)
+{
+	struct font_entry *font;
+	struct list *index;
+
+	pthread_mutex_lock(&fonts_mutex);
+	for (index = fonts_head; index != NULL; index = index->next) {
+		font = index->data;
+
+		if (strcmp(font->name, name) == 0) {
+			font->refs++;
+			pthread_mutex_unlock(&fonts_mutex);
+			return font->desc;
+		}
+	}
+
+	font = malloc(sizeof(struct font_entry));
+	if (font == NULL) {
+		pthread_mutex_unlock(&fonts_mutex);
+		return NULL;
+	}
+
+	font->name = strdup(name);
+	font->desc = pango_font_description_from_string(name);
+	font->refs = 1;
+
+	if (list_add(&fonts_head, font) == NULL) {
+		pango_font_description_free(font->desc);
+		free(font->name);
+		free(font);
+		pthread_mutex_unlock(&fonts_mutex);
+		return NULL;
+	}
+
+	pthread_mutex_unlock(&fonts_mutex);
+	return font->desc;
+}
+
+static void font_put(PangoFontDescription *desc)
+{
+	struct font_entry *font;
+	struct list *index;
+
+	pthread_mutex_lock(&fonts_mutex);
+	for (index = fonts_head; index != NULL; index = index->next) {
+		font = index->data;
+
+		if (font->desc != desc)
+			continue;
+
+		if (--font->refs == 0) {
+			pango_font_description_free(font->desc);
+			free(font->name);
+			list_remove(&fonts_head, index);
+		}
+		break;
+	}
+	pthread_mutex_unlock(&fonts_mutex);
+}
 
 struct draw_t *draw_create(cairo_surface_t *src, const char *font)
 {
@@ -31,25 +167,111 @@ struct draw_t *draw_create(cairo_surface_t *src, const char *font)
 
 	draw = malloc(sizeof(struct draw_t));
 	draw->cr = cairo_create(src);
-	draw->layout = pango_cairo_create_layout(draw->cr);
+	draw->font = NULL;
+	draw->texts = calloc(TEXT_CACHE_SIZE, sizeof(struct text_entry));
 	draw_set_font(draw, font);
 
 	return draw;
 }
 
+static void text_flush(struct draw_t *draw)
+{
+	struct text_entry *entry;
+	int i;
+
+	if (draw->texts == NULL)
+		return;
+
+	for (i = 0; i < TEXT_CACHE_SIZE; i++) {
+		entry = &draw->texts[i];
+		if (entry->layout == NULL)
+			continue;
+
+		g_object_unref(entry->layout);
+		free(entry->text);
+		memset(entry, 0, sizeof(struct text_entry));
+	}
+}
+
+static uint32_t text_hash(const char *text, size_t len)
+{
+	uint32_t hash = 2166136261u;
+	size_t i;
+
+	/* FNV-1a */
+	for (i = 0; i < len; i++) {
+		hash ^= (unsigned char)text[i];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+/* layout of the text in the current font, shaped only on a miss */
+static struct text_entry *text_lookup(struct draw_t *draw, const char *text,
+				      size_t len)
+{
+	uint32_t hash = text_hash(text, len);
+	struct text_entry *entry;
+	struct timespec start, end;
+
+	if (draw->texts == NULL)
+		return NULL;
+
+	entry = &draw->texts[hash % TEXT_CACHE_SIZE];
+	if (entry->layout != NULL && entry->hash == hash && entry->len == len
+	    && memcmp(entry->text, text, len) == 0) {
+		metrics_inc(METRIC_TEXT_CACHED);
+		return entry;
+	}
+
+	/* replace what was in the slot */
+	if (entry->layout != NULL) {
+		g_object_unref(entry->layout);
+		free(entry->text);
+	}
+
+	entry->text = malloc(len);
+	if (entry->text == NULL) {
+		memset(entry, 0, sizeof(struct text_entry));
+		return NULL;
+	}
+	memcpy(entry->text, text, len);
+	entry->hash = hash;
+	entry->len = len;
+
+	/* context of the thread drawing, not the one creating the draw_t */
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	entry->layout = pango_layout_new(context_get(draw->cr));
+	pango_layout_set_font_description(entry->layout, draw->font);
+	pango_layout_set_alignment(entry->layout, PANGO_ALIGN_CENTER);
+	pango_layout_set_text(entry->layout, text, len);
+	pango_layout_get_pixel_size(entry->layout, &entry->width,
+				    &entry->height);
+	entry->area_w = entry->area_h = -1;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	metrics_inc(METRIC_TEXT_SHAPED);
+	metrics_add(METRIC_TEXT_SHAPE_US,
+		    (end.tv_sec - start.tv_sec) * 1000000L
+			    + (end.tv_nsec - start.tv_nsec) / 1000L);
+
+	return entry;
+}
+
 void draw_destroy(struct draw_t *draw)
 {
 	if (draw == NULL)
 		return;
 
+	text_flush(draw);
+	free(draw->texts);
+
 	if (draw->cr != NULL)
 		cairo_destroy(draw->cr);
 
 	if (draw->font != NULL)
-		pango_font_description_free(draw->font);
-
-	if (draw->layout != NULL)
-		g_object_unref(draw->layout);
+		font_put(draw->font);
 
 	free(draw);
 }
@@ -59,8 +281,13 @@ void draw_set_font(struct draw_t *draw, const char *font)
 	if ((draw == NULL) || (font == NULL))
 		return;
 
-	draw->font = pango_font_description_from_string(font);
-	pango_layout_set_font_description(draw->layout, draw->font);
+	/* cached texts were shaped with the previous font */
+	text_flush(draw);
+
+	if (draw->font != NULL)
+		font_put(draw->font);
+
+	draw->font = font_get(font);
 }
 
 void draw_set_color(struct draw_t *draw, enum color_t color)
@@ -79,57 +306,242 @@ void draw_set_color(struct draw_t *draw, enum color_t color)
 		cairo_set_source_rgb(draw->cr, 0.98, 0.52, 0.07);
 		break;
 	}
-	pango_cairo_update_layout(draw->cr, draw->layout);
 }
 
 void draw_get_text_prop(struct draw_t *draw, char *text, size_t len, int *width,
 			int *height)
 {
-	PangoLayout *tmp;
+	struct text_entry *entry;
 
 	if ((draw == NULL) || (draw->cr == NULL))
 		return;
 
-	tmp = pango_cairo_create_layout(draw->cr);
-	pango_layout_set_text(tmp, text, len);
-	pango_layout_get_pixel_size(tmp, width, height);
+	entry = text_lookup(draw, text, len);
+	if (entry == NULL)
+		return;
 
-	g_object_unref(tmp);
+	if (width != NULL)
+		*width = entry->width;
+	if (height != NULL)
+		*height = entry->height;
 }
 
 void draw_text(struct draw_t *draw, char *text, size_t len, struct area_t area)
 {
-	if ((draw == NULL) || (draw->layout == NULL) || (draw->cr == NULL))
+	struct text_entry *entry;
+
+	if ((draw == NULL) || (draw->cr == NULL))
 		return;
 
-	cairo_save(draw->cr);
+	entry = text_lookup(draw, text, len);
+	if (entry == NULL)
+		return;
 
-	/* set text and get size */
-	pango_layout_set_text(draw->layout, text, len);
+	cairo_save(draw->cr);
 
-	/* set geometry */
-	pango_layout_set_width(draw->layout, area.width * PANGO_SCALE);
-	pango_layout_set_height(draw->layout, area.height * PANGO_SCALE);
-	pango_layout_set_alignment(draw->layout, PANGO_ALIGN_CENTER);
+	/* set geometry, lines are computed again only if it changed */
+	if (entry->area_w != (int)area.width
+	    || entry->area_h != (int)area.height) {
+		entry->area_w = area.width;
+		entry->area_h = area.height;
+		pango_layout_set_width(entry->layout, area.width * PANGO_SCALE);
+		pango_layout_set_height(entry->layout,
+					area.height * PANGO_SCALE);
+	}
 
 	/* move and show layout */
 	cairo_move_to(draw->cr, area.x, area.y);
-	pango_cairo_show_layout(draw->cr, draw->layout);
+	pango_cairo_show_layout(draw->cr, entry->layout);
 
 	cairo_restore(draw->cr);
 }
 
-void draw_icon(struct draw_t *draw, const char *path, struct area_t area)
+static void icon_entry_free(struct list *index)
+{
+	struct icon_entry *entry = index->data;
+
+	cairo_surface_destroy(entry->surface);
+	free(entry->path);
+	list_remove(&icons_head, index);
+	icons_count--;
+}
+
+static cairo_surface_t *icon_scale(cairo_surface_t *image, int size)
+{
+	int width = cairo_image_surface_get_width(image);
+	int height = cairo_image_surface_get_height(image);
+	double scale = (double)size / (width > height ? width : height);
+	cairo_surface_t *surface;
+	cairo_t *cr;
+
+	/* premultiplied ARGB, centered keeping the aspect ratio */
+	surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, size, size);
+	cr = cairo_create(surface);
+	cairo_translate(cr, (size - width * scale) / 2,
+			(size - height * scale) / 2);
+	cairo_scale(cr, scale, scale);
+	cairo_set_source_surface(cr, image, 0, 0);
+	cairo_pattern_set_filter(cairo_get_source(cr), CAIRO_FILTER_GOOD);
+	cairo_paint(cr);
+	cairo_destroy(cr);
+
+	return surface;
+}
+
+/* size 0 keeps the size of the file */
+static cairo_surface_t *icon_lookup(const char *path, int size)
 {
+	struct icon_entry *entry;
+	struct list *index;
 	cairo_surface_t *image;
+	struct stat st;
 
-	if ((draw == NULL) || (draw->cr == NULL))
-		return;
+	if (stat(path, &st) == -1)
+		return NULL;
+
+	for (index = icons_head; index != NULL; index = index->next) {
+		entry = index->data;
+
+		if (entry->size != size || strcmp(entry->path, path) != 0)
+			continue;
+
+		/* file changed since it was decoded */
+		if (entry->mtime == st.st_mtime)
+			return entry->surface;
+		icon_entry_free(index);
+		break;
+	}
 
 	image = cairo_image_surface_create_from_png(path);
-	cairo_set_source_surface(draw->cr, image, area.x, area.y);
+	if (cairo_surface_status(image) != CAIRO_STATUS_SUCCESS) {
+		cairo_surface_destroy(image);
+		return NULL;
+	}
+
+	entry = malloc(sizeof(struct icon_entry));
+	if (entry == NULL) {
+		cairo_surface_destroy(image);
+		return NULL;
+	}
+
+	entry->path = strdup(path);
+	entry->size = size;
+	entry->mtime = st.st_mtime;
+	if (size > 0) {
+		entry->surface = icon_scale(image, size);
+		cairo_surface_destroy(image);
+	} else
+		entry->surface = image;
+
+	/* oldest decoded icon goes first */
+	if (icons_count >= ICON_CACHE_MAX)
+		icon_entry_free(icons_head);
+
+	if (list_add(&icons_head, entry) == NULL) {
+		cairo_surface_destroy(entry->surface);
+		free(entry->path);
+		free(entry);
+		return NULL;
+	}
+	icons_count++;
+
+	return entry->surface;
+}
+
+cairo_surface_t *draw_icon_load(const char *path, int size)
+{
+	cairo_surface_t *icon;
+	int state;
+
+	/* the thread of the widgets is canceled, never with the lock */
+	pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &state);
+	pthread_mutex_lock(&icons_mutex);
+
+	/* the cache keeps its own reference, the other thread may evict */
+	icon = icon_lookup(path, size);
+	if (icon != NULL)
+		cairo_surface_reference(icon);
+
+	pthread_mutex_unlock(&icons_mutex);
+	pthread_setcancelstate(state, NULL);
+
+	return icon;
+}
+
+bool draw_icon(struct draw_t *draw, const char *path, struct area_t area)
+{
+	cairo_surface_t *icon;
+	int size = area.height;
+
+	if ((draw == NULL) || (draw->cr == NULL))
+		return false;
+
+	/* no area given, drawn at the size of the file */
+	if (area.width <= 0 || area.height <= 0)
+		size = 0;
+
+	icon = draw_icon_load(path, size);
+	if (icon == NULL)
+		return false;
+
+	cairo_set_source_surface(draw->cr, icon, area.x, area.y);
 	cairo_paint(draw->cr);
+	cairo_surface_destroy(icon);
+
+	return true;
+}
+
+cairo_surface_t *draw_icon_from_argb(const uint32_t *data, int width,
+				     int height, int size)
+{
+	cairo_surface_t *image, *surface;
+	uint32_t *pixels, p, a;
+	int x, y, stride;
+
+	image = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, width, height);
+	if (cairo_surface_status(image) != CAIRO_STATUS_SUCCESS) {
+		cairo_surface_destroy(image);
+		return NULL;
+	}
+
+	/* straight alpha to the premultiplied one of cairo */
+	cairo_surface_flush(image);
+	pixels = (uint32_t *)cairo_image_surface_get_data(image);
+	stride = cairo_image_surface_get_stride(image) / 4;
+	for (y = 0; y < height; y++) {
+		for (x = 0; x < width; x++) {
+			p = data[y * width + x];
+			a = p >> 24;
+			pixels[y * stride + x] =
+				(a << 24) | ((p >> 16 & 0xff) * a / 255) << 16
+				| ((p >> 8 & 0xff) * a / 255) << 8
+				| ((p & 0xff) * a / 255);
+		}
+	}
+	cairo_surface_mark_dirty(image);
+
+	surface = icon_scale(image, size);
 	cairo_surface_destroy(image);
+
+	return surface;
+}
+
+void draw_surface(struct draw_t *draw, cairo_surface_t *surface,
+		  struct area_t area)
+{
+	if ((draw == NULL) || (draw->cr == NULL) || (surface == NULL))
+		return;
+
+	cairo_set_source_surface(draw->cr, surface, area.x, area.y);
+	cairo_paint(draw->cr);
+}
+
+void draw_icon_cache_clear(void)
+{
+	pthread_mutex_lock(&icons_mutex);
+	while (icons_head != NULL)
+		icon_entry_free(icons_head);
+	pthread_mutex_unlock(&icons_mutex);
 }
 
 void draw_rectangle(struct draw_t *draw, struct area_t area, bool fill)
@@ -142,6 +554,25 @@ void draw_rectangle(struct draw_t *draw, struct area_t area, bool fill)
 		cairo_fill(draw->cr);
 }
 
+void draw_clip(struct draw_t *draw, struct area_t area)
+{
+	if ((draw == NULL) || (draw->cr == NULL))
+		return;
+
+	cairo_reset_clip(draw->cr);
+	cairo_new_path(draw->cr);
+	cairo_rectangle(draw->cr, area.x, area.y, area.width, area.height);
+	cairo_clip(draw->cr);
+}
+
+void draw_clip_reset(struct draw_t *draw)
+{
+	if ((draw == NULL) || (draw->cr == NULL))
+		return;
+
+	cairo_reset_clip(draw->cr);
+}
+
 void draw_rounded_rectangle(struct draw_t *draw, struct area_t area)
 {
 	double aspect = 1.0;
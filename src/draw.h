@@ -21,14 +21,17 @@
 #define DRAW_H
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <pango/pangocairo.h>
 
 enum color_t { BLACK, GREY, ORANGE };
 
+struct text_entry;
+
 struct draw_t {
 	cairo_t *cr;
-	PangoLayout *layout;
 	PangoFontDescription *font;
+	struct text_entry *texts; /* shaped layouts, see text_lookup() */
 };
 
 struct area_t {
@@ -50,8 +53,21 @@ void draw_get_text_prop(struct draw_t *draw, char *text, size_t len, int *width,
 
 /* draw */
 void draw_text(struct draw_t *draw, char *text, size_t len, struct area_t area);
-void draw_icon(struct draw_t *draw, const char *path, struct area_t area);
+bool draw_icon(struct draw_t *draw, const char *path, struct area_t area);
 void draw_rectangle(struct draw_t *draw, struct area_t area, bool fill);
 void draw_rounded_rectangle(struct draw_t *draw, struct area_t area);
+void draw_surface(struct draw_t *draw, cairo_surface_t *surface,
+		  struct area_t area);
+
+/* restrict the next draws to an area, until draw_clip_reset */
+void draw_clip(struct draw_t *draw, struct area_t area);
+void draw_clip_reset(struct draw_t *draw);
+
+/* icons scaled to size x size (0 for the size of the file), to release with
+ * cairo_surface_destroy */
+cairo_surface_t *draw_icon_load(const char *path, int size);
+cairo_surface_t *draw_icon_from_argb(const uint32_t *data, int width,
+				     int height, int size);
+void draw_icon_cache_clear(void);
 
 #endif
@@ -20,12 +20,16 @@
 #include <errno.h>
 #include <stdlib.h>
 #include <signal.h>
-#include <sys/timerfd.h>
+#include <unistd.h>
+#include <sys/signalfd.h>
+#include <sys/wait.h>
 #include <xcb/xcb.h>
 #include <xcb/xproto.h>
 #include <xcb/randr.h>
 
 #include "global.h"
+#include "list.h"
+#include "event.h"
 #include "monitor.h"
 #include "action.h"
 #include "window.h"
@@ -33,18 +37,61 @@
 #include "input.h"
 #include "log.h"
 #include "panel.h"
+#include "shadow.h"
+#include "cursor.h"
+#include "metrics.h"
+#include "idle.h"
+#include "spawner.h"
+#include "launcher.h"
 
 void (*events[XCB_NO_OPERATION])(xcb_generic_event_t *e);
 
-/* Signal code. Non-zero if we've been interruped by a signal. */
+/* events drained at once, then dispatched by class */
+#define EVENT_BATCH_MAX 256
+
+enum event_class {
+	EVENT_CLASS_INPUT,     /* keys, buttons, motion */
+	EVENT_CLASS_STRUCTURE, /* map, configure, crossing, messages ... */
+	EVENT_CLASS_PAINT,     /* expose and panel work */
+	EVENT_CLASS_LAST
+};
+
+/* file descriptors watched by the main loop, besides the X one */
+struct event_fd {
+	int fd;
+	void (*func)(void *data);
+	void *data;
+};
+
+static struct list *event_fds_head = NULL;
+
+/* Signal code. Non-zero if we've been asked to stop by a signal. */
 static int sigcode;
 
+/* signals read from the signalfd, blocked everywhere else */
+static sigset_t signal_mask;
+static int signal_fd = -1;
+
 static void keypress(xcb_generic_event_t *e)
 {
 	xcb_key_press_event_t *ev = (xcb_key_press_event_t *)e;
+	cursor_track_coordinates(ev->root_x, ev->root_y);
+
+	/* the launcher has the keyboard grabbed */
+	if (launcher_active()) {
+		launcher_key(ev);
+		return;
+	}
+
 	input_key_handler(ev);
 }
 
+static void mappingnotify(xcb_generic_event_t *e)
+{
+	xcb_mapping_notify_event_t *ev = (xcb_mapping_notify_event_t *)e;
+	input_mapping_handler(ev);
+}
+
 static void maprequest(xcb_generic_event_t *e)
 {
 	xcb_map_request_event_t *ev = (xcb_map_request_event_t *)e;
@@ -60,29 +107,85 @@ static void configurerequest(xcb_generic_event_t *e)
 static void buttonpress(xcb_generic_event_t *e)
 {
 	xcb_button_press_event_t *ev = (xcb_button_press_event_t *)e;
+	cursor_track_coordinates(ev->root_x, ev->root_y);
 	input_button_handler(ev);
 	panel_click(ev);
 }
 
+static void createnotify(xcb_generic_event_t *e)
+{
+	xcb_create_notify_event_t *ev = (xcb_create_notify_event_t *)e;
+	shadow_create(ev);
+}
+
 static void destroynotify(xcb_generic_event_t *e)
 {
 	xcb_destroy_notify_event_t *ev = (xcb_destroy_notify_event_t *)e;
 	client_destroy(ev);
+	shadow_destroy(ev);
+}
+
+static void configurenotify(xcb_generic_event_t *e)
+{
+	xcb_configure_notify_event_t *ev = (xcb_configure_notify_event_t *)e;
+	shadow_configure(ev);
+}
+
+static void motionnotify(xcb_generic_event_t *e)
+{
+	xcb_motion_notify_event_t *ev = (xcb_motion_notify_event_t *)e;
+	cursor_track_coordinates(ev->root_x, ev->root_y);
+}
+
+static void mapnotify(xcb_generic_event_t *e)
+{
+	xcb_map_notify_event_t *ev = (xcb_map_notify_event_t *)e;
+	shadow_map(ev);
+}
+
+static void reparentnotify(xcb_generic_event_t *e)
+{
+	xcb_reparent_notify_event_t *ev = (xcb_reparent_notify_event_t *)e;
+	shadow_reparent(ev);
 }
 
 static void enternotify(xcb_generic_event_t *e)
 {
 	xcb_enter_notify_event_t *ev = (xcb_enter_notify_event_t *)e;
+	cursor_track_coordinates(ev->root_x, ev->root_y);
+
+	/* crossing caused by our own raise or warp */
+	if (window_ignore_enter(ev)) {
+		metrics_inc(METRIC_ENTER_SUPPRESSED);
+		return;
+	}
+
 	client_enter(ev);
 }
 
+static void leavenotify(xcb_generic_event_t *e)
+{
+	xcb_leave_notify_event_t *ev = (xcb_leave_notify_event_t *)e;
+
+	/* the pointer now moves where we get no events */
+	if (ev->event == screen->root)
+		cursor_invalidate_coordinates();
+}
+
 static void unmapnotify(xcb_generic_event_t *e)
 {
 	xcb_unmap_notify_event_t *ev = (xcb_unmap_notify_event_t *)e;
+	shadow_unmap(ev);
 	client_unmap(ev);
 	panel_remove_systray(ev);
 }
 
+static void propertynotify(xcb_generic_event_t *e)
+{
+	xcb_property_notify_event_t *ev = (xcb_property_notify_event_t *)e;
+	client_property(ev);
+}
+
 static void clientmessage(xcb_generic_event_t *e)
 {
 	xcb_client_message_event_t *ev = (xcb_client_message_event_t *)e;
@@ -90,35 +193,169 @@ static void clientmessage(xcb_generic_event_t *e)
 	panel_add_systray(ev);
 }
 
-static void sigcatch(const int sig)
+static enum event_class event_classify(xcb_generic_event_t *ev)
 {
-	sigcode = sig;
+	switch (ev->response_type & ~0x80) {
+	case XCB_KEY_PRESS:
+	case XCB_KEY_RELEASE:
+	case XCB_BUTTON_PRESS:
+	case XCB_BUTTON_RELEASE:
+	case XCB_MOTION_NOTIFY:
+		return EVENT_CLASS_INPUT;
+	case XCB_EXPOSE:
+		return EVENT_CLASS_PAINT;
+	default:
+		return EVENT_CLASS_STRUCTURE;
+	}
 }
 
-static void install_sig_handlers(void)
+/* events handled in arrival order: the keymap must be updated before
+ * the keys after it are decoded, and input must not reach a window
+ * already destroyed, unmapped or reparented */
+static bool event_barrier(xcb_generic_event_t *ev)
 {
-	struct sigaction sa;
+	switch (ev->response_type & ~0x80) {
+	case XCB_MAPPING_NOTIFY:
+	case XCB_DESTROY_NOTIFY:
+	case XCB_UNMAP_NOTIFY:
+	case XCB_REPARENT_NOTIFY:
+		return true;
+	default:
+		return false;
+	}
+}
 
-	sa.sa_handler = SIG_IGN;
-	sigemptyset(&sa.sa_mask);
-	sa.sa_flags = SA_NOCLDSTOP;
-	/*could not initialize signal handler */
-	if (sigaction(SIGCHLD, &sa, NULL) == -1)
-		exit(-1);
-	sa.sa_handler = sigcatch;
-	sigemptyset(&sa.sa_mask);
-	sa.sa_flags = 1; /* Restart if interrupted by handler */
-	if (sigaction(SIGINT, &sa, NULL) == -1
-	    || sigaction(SIGHUP, &sa, NULL) == -1
-	    || sigaction(SIGTERM, &sa, NULL) == -1)
+static void event_dispatch(xcb_generic_event_t *ev)
+{
+	/* expose event only for panel */
+	if ((ev->response_type & ~0x80) == XCB_EXPOSE)
+		panel_event((xcb_expose_event_t *)ev);
+
+	/* monitor event */
+	monitor_event(ev->response_type);
+
+	if (events[ev->response_type & ~0x80])
+		events[ev->response_type & ~0x80](ev);
+}
+
+static void event_drain(void)
+{
+	xcb_generic_event_t *batch[EVENT_BATCH_MAX];
+	enum event_class class[EVENT_BATCH_MAX];
+	xcb_generic_event_t *ev;
+	int count, start, end, i, c;
+
+	do {
+		/* drain what is already queued */
+		count = 0;
+		while (count < EVENT_BATCH_MAX
+		       && (ev = xcb_poll_for_event(conn))) {
+			batch[count] = ev;
+			class[count] = event_classify(ev);
+			count++;
+		}
+
+		/* dispatch by priority, arrival order within a class, and
+		 * never across a barrier */
+		for (start = 0; start < count; start = end + 1) {
+			for (end = start; end < count; end++)
+				if (event_barrier(batch[end]))
+					break;
+
+			for (c = 0; c < EVENT_CLASS_LAST; c++)
+				for (i = start; i < end; i++)
+					if (class[i] == (enum event_class)c)
+						event_dispatch(batch[i]);
+
+			if (end < count)
+				event_dispatch(batch[end]);
+		}
+
+		for (i = 0; i < count; i++)
+			free(batch[i]);
+
+		xcb_flush(conn);
+
+		/* replies read while dispatching may have queued more */
+	} while (count > 0);
+}
+
+static void signal_reap(void)
+{
+	pid_t pid;
+	int status;
+
+	/* several children may be behind a single SIGCHLD */
+	while ((pid = waitpid(-1, &status, WNOHANG)) > 0)
+		spawner_child_exited(pid, status);
+}
+
+static void signal_event(void __attribute__((__unused__)) * data)
+{
+	struct signalfd_siginfo info;
+
+	while (read(signal_fd, &info, sizeof(info)) == sizeof(info)) {
+		switch (info.ssi_signo) {
+		case SIGINT:
+		case SIGTERM:
+			/* leave the main loop, cleanup runs at exit */
+			sigcode = info.ssi_signo;
+			break;
+		case SIGHUP:
+			LOGI("SIGHUP received, reload conf");
+			reload_conf(NULL);
+			break;
+		case SIGUSR1:
+			metrics_dump();
+			break;
+		case SIGCHLD:
+			signal_reap();
+			break;
+		}
+	}
+}
+
+void event_block_signals(void)
+{
+	sigemptyset(&signal_mask);
+	sigaddset(&signal_mask, SIGINT);
+	sigaddset(&signal_mask, SIGTERM);
+	sigaddset(&signal_mask, SIGHUP);
+	sigaddset(&signal_mask, SIGUSR1);
+	sigaddset(&signal_mask, SIGCHLD);
+
+	/* threads created afterwards inherit the mask */
+	if (sigprocmask(SIG_BLOCK, &signal_mask, NULL) == -1)
 		exit(-1);
 }
 
+void event_unblock_signals(void)
+{
+	sigset_t empty;
+
+	/* for children, exec keeps the blocked mask */
+	sigemptyset(&empty);
+	sigprocmask(SIG_SETMASK, &empty, NULL);
+}
+
+static bool install_signal_fd(void)
+{
+	signal_fd = signalfd(-1, &signal_mask, SFD_NONBLOCK | SFD_CLOEXEC);
+	if (signal_fd == -1) {
+		LOGE("Failed to create signalfd");
+		return false;
+	}
+
+	return event_add_fd(signal_fd, signal_event, NULL);
+}
+
 bool event_init(void)
 {
 	unsigned int values[1] = {XCB_EVENT_MASK_SUBSTRUCTURE_REDIRECT
 				  | XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY
 				  | XCB_EVENT_MASK_BUTTON_PRESS
+				  | XCB_EVENT_MASK_ENTER_WINDOW
+				  | XCB_EVENT_MASK_LEAVE_WINDOW
 				  | XCB_EVENT_MASK_EXPOSURE};
 	xcb_void_cookie_t cookie;
 	xcb_generic_error_t *error;
@@ -143,33 +380,67 @@ bool event_init(void)
 	events[XCB_CLIENT_MESSAGE] = clientmessage;
 
 	/* XCB_EVENT_MASK_SUBSTRUCTURE_NOTIFY */
+	events[XCB_CREATE_NOTIFY] = createnotify;
 	events[XCB_DESTROY_NOTIFY] = destroynotify;
+	events[XCB_CONFIGURE_NOTIFY] = configurenotify;
+	events[XCB_MAP_NOTIFY] = mapnotify;
+	events[XCB_REPARENT_NOTIFY] = reparentnotify;
 	events[XCB_ENTER_NOTIFY] = enternotify;
+	events[XCB_LEAVE_NOTIFY] = leavenotify;
 	events[XCB_UNMAP_NOTIFY] = unmapnotify;
 
+	/* XCB_EVENT_MASK_PROPERTY_CHANGE of clients */
+	events[XCB_PROPERTY_NOTIFY] = propertynotify;
+
 	/* XCB_EVENT_MASK_BUTTON_PRESS */
 	events[XCB_BUTTON_PRESS] = buttonpress;
 	events[XCB_KEY_PRESS] = keypress;
+	events[XCB_MOTION_NOTIFY] = motionnotify;
+
+	/* always sent by the server */
+	events[XCB_MAPPING_NOTIFY] = mappingnotify;
+
+	return install_signal_fd();
+}
+
+bool event_add_fd(int fd, void (*func)(void *data), void *data)
+{
+	struct event_fd *event_fd;
+
+	event_fd = malloc(sizeof(struct event_fd));
+	if (event_fd == NULL)
+		return false;
+
+	event_fd->fd = fd;
+	event_fd->func = func;
+	event_fd->data = data;
+	if (list_add(&event_fds_head, event_fd) == NULL) {
+		free(event_fd);
+		return false;
+	}
 
-	install_sig_handlers();
 	return true;
 }
 
-void event_loop(void)
+void event_remove_fd(int fd)
 {
-	int fd;
-	xcb_generic_event_t *ev;
+	struct event_fd *event_fd;
+	struct list *index;
+
+	for (index = event_fds_head; index != NULL; index = index->next) {
+		event_fd = index->data;
+
+		if (event_fd->fd == fd) {
+			list_remove(&event_fds_head, index);
+			return;
+		}
+	}
+}
 
-	/* panel refresh */
-	struct panel *panel = panel_get();
-	int timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
-	struct itimerspec itimer;
-	itimer.it_value.tv_sec = panel->refresh;
-	itimer.it_value.tv_nsec = 0;
-	itimer.it_interval.tv_sec = panel->refresh;
-	itimer.it_interval.tv_nsec = 0;
-	if (timerfd_settime(timer_fd, 0, &itimer, NULL))
-		LOGE("Failed to start timer");
+void event_loop(void)
+{
+	struct event_fd *event_fd;
+	struct list *index, *next;
 
 	/* X events */
 	int xfd = xcb_get_file_descriptor(conn);
@@ -177,7 +448,8 @@ void event_loop(void)
 	/* select vars */
 	int rc;
 	fd_set fds;
-	int max_fd = timer_fd > xfd ? timer_fd : xfd;
+	int max_fd;
+	struct timeval poll = {0, 0};
 
 	sigcode = 0;
 
@@ -186,60 +458,49 @@ void event_loop(void)
 		/* init file descriptors */
 		FD_ZERO(&fds);
 		FD_SET(xfd, &fds);
-		FD_SET(timer_fd, &fds);
+		max_fd = xfd;
+		for (index = event_fds_head; index != NULL;
+		     index = index->next) {
+			event_fd = index->data;
+			FD_SET(event_fd->fd, &fds);
+			if (event_fd->fd > max_fd)
+				max_fd = event_fd->fd;
+		}
 
-		/* waiting until file descriptors become "ready" */
-		rc = select(max_fd + 1, &fds, NULL, NULL, NULL);
+		/* waiting until file descriptors become "ready", only poll
+		 * them when idle work is waiting */
+		poll.tv_sec = poll.tv_usec = 0;
+		rc = select(max_fd + 1, &fds, NULL, NULL,
+			    idle_pending() ? &poll : NULL);
 		if (rc < 0) {
 			if (errno == EINTR)
-				break;
+				continue;
 			LOGE("select()");
 			break;
 		}
 
-		/* check which fd is available to read */
-		for (fd = 0; fd <= max_fd; fd++) {
-
-			if (FD_ISSET(fd, &fds)) {
-
-				/* X events */
-				if (fd == xfd) {
-					if (xcb_connection_has_error(conn))
-						abort();
-
-					while ((ev = xcb_poll_for_event(
-							conn))) {
-
-						/* expose event only for panel
-						 */
-						if ((ev->response_type & ~0x80)
-						    == XCB_EXPOSE)
-							panel_event((
-								xcb_expose_event_t
-									*)ev);
-
-						/* monitor event */
-						monitor_event(
-							ev->response_type);
-
-						if (events[ev->response_type
-							   & ~0x80])
-							events[ev->response_type
-							       & ~0x80](ev);
+		/* nothing to read, X queue is empty: run deferred work */
+		if (rc == 0) {
+			idle_run();
+			continue;
+		}
 
-						free(ev);
-					}
+		/* X events first */
+		if (FD_ISSET(xfd, &fds) && xcb_connection_has_error(conn))
+			abort();
+		event_drain();
 
-					xcb_flush(conn);
+		/* handlers may remove themselves */
+		for (index = event_fds_head; index != NULL; index = next) {
+			next = index->next;
+			event_fd = index->data;
 
-				} else if (fd == timer_fd) {
-					/* panel refresh */
-					panel_draw();
-					timerfd_settime(timer_fd, 0, &itimer,
-							NULL);
-				}
-			}
+			if (FD_ISSET(event_fd->fd, &fds))
+				event_fd->func(event_fd->data);
 		}
+
+		/* handlers may have read replies along with events */
+		event_drain();
 	}
 }
 
@@ -20,8 +20,18 @@
 #ifndef EVENT_H
 #define EVENT_H
 
+#include <stdbool.h>
+
+void event_block_signals(void);
+
+void event_unblock_signals(void);
+
 bool event_init(void);
 
+bool event_add_fd(int fd, void (*func)(void *data), void *data);
+
+void event_remove_fd(int fd);
+
 void event_loop(void);
 
 void event_exit(void);
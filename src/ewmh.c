@@ -27,11 +27,16 @@
 /* Ewmh Connection. */
 xcb_ewmh_connection_t *ewmh;
 
+/* screen managed by the WM */
+static int ewmh_scrno;
+
 void ewmh_init(int scrno)
 {
 	if (!(ewmh = calloc(1, sizeof(xcb_ewmh_connection_t))))
 		printf("Fail\n");
 
+	ewmh_scrno = scrno;
+
 	xcb_intern_atom_cookie_t *cookie = xcb_ewmh_init_atoms(conn, ewmh);
 	xcb_ewmh_init_atoms_replies(ewmh, cookie, (void *)0);
 
@@ -61,6 +66,15 @@ void ewmh_init(int scrno)
 				  ewmh->_NET_WM_STATE_DEMANDS_ATTENTION};
 
 	xcb_ewmh_set_supported(ewmh, scrno, LENGTH(net_atoms), net_atoms);
+
+	/* advertised above, exists before the first client is mapped */
+	xcb_ewmh_set_client_list(ewmh, scrno, 0, NULL);
+}
+
+void ewmh_set_client_list(xcb_window_t *list, uint32_t len)
+{
+	xcb_ewmh_set_client_list(ewmh, ewmh_scrno, len, list);
+	xcb_flush(conn);
 }
 
 void ewmh_exit(void)
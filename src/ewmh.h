@@ -20,8 +20,13 @@
 #ifndef EWMH_H
 #define EWMH_H
 
+#include <stdint.h>
+#include <xcb/xcb.h>
+
 void ewmh_init(int scrno);
 
+void ewmh_set_client_list(xcb_window_t *list, uint32_t len);
+
 void ewmh_exit(void);
 
 #endif
@@ -0,0 +1,680 @@
+/*
+ * This file is part of the jwm distribution:
+ * https://github.com/JulienMasson/jwm
+ *
+ * Copyright (c) 2017 Julien Masson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "icontheme.h"
+#include "log.h"
+#include "utils.h"
+
+/* Freedesktop icon themes resolved to one PNG per icon name, for the
+ * single size we draw icons at. The index is built by walking the theme
+ * directories once and saved in a cache file. The file is mapped at
+ * startup and reused as long as the mtime of every directory it was
+ * built from is unchanged, a lookup is a binary search in the mapping. */
+
+#define ICONTHEME_MAGIC "JWMI"
+#define ICONTHEME_VERSION 1
+#define ICONTHEME_CHAIN_MAX 8
+#define ICONTHEME_BASES_MAX 16
+#define ICONTHEME_PIXMAPS "/usr/share/pixmaps"
+
+/* cache file: header, dirs, entries sorted by name, then strings */
+struct cache_header {
+	char magic[4];
+	uint32_t version;
+	uint32_t size;
+	uint32_t bases_count; /* first dirs, in the order they are searched */
+	uint32_t dirs_count;
+	uint32_t entries_count;
+	uint32_t strings_size;
+	uint32_t pad;
+};
+
+/* directory scanned, its mtime is the stamp checked to reuse the cache */
+struct cache_dir {
+	int64_t mtime; /* in ns, -1 if missing */
+	uint32_t path;
+	uint32_t pad;
+};
+
+struct cache_entry {
+	uint32_t name;
+	uint32_t dir;
+};
+
+enum dir_type { DIR_FIXED, DIR_SCALABLE, DIR_THRESHOLD };
+
+/* sub directory described in index.theme */
+struct theme_dir {
+	char *name;
+	int size, min, max, threshold, scale;
+	enum dir_type type;
+};
+
+struct candidate {
+	char *name;
+	uint32_t dir;
+	int rank;     /* theme position in the inheritance chain */
+	int distance; /* from the size we want */
+};
+
+struct builder {
+	int size;
+	char *strings;
+	size_t strings_size, strings_alloc;
+	struct cache_dir *dirs;
+	uint32_t dirs_count;
+	struct candidate *candidates;
+	size_t candidates_count, candidates_alloc;
+};
+
+/* mapped cache */
+static void *cache_map = NULL;
+static size_t cache_len = 0;
+static const struct cache_header *header;
+static const struct cache_dir *cache_dirs;
+static const struct cache_entry *cache_entries;
+static const char *cache_strings;
+
+/* base directories of the themes, by priority */
+static char *bases[ICONTHEME_BASES_MAX];
+static int bases_count = 0;
+
+static void bases_add(const char *dir)
+{
+	char path[PATH_MAX];
+
+	if (bases_count == ICONTHEME_BASES_MAX || dir[0] == '\0')
+		return;
+
+	snprintf(path, sizeof(path), "%s/icons", dir);
+	bases[bases_count++] = strdup(path);
+}
+
+static void bases_clear(void)
+{
+	while (bases_count > 0)
+		free(bases[--bases_count]);
+}
+
+static void bases_init(void)
+{
+	const char *home = getenv("HOME");
+	const char *env;
+	char path[PATH_MAX], *dirs, *token, *saveptr;
+
+	bases_clear();
+
+	/* legacy ~/.icons first, then the XDG data directories */
+	if (home != NULL) {
+		snprintf(path, sizeof(path), "%s/.icons", home);
+		bases[bases_count++] = strdup(path);
+	}
+
+	env = getenv("XDG_DATA_HOME");
+	if (env != NULL && env[0] != '\0')
+		bases_add(env);
+	else if (home != NULL) {
+		snprintf(path, sizeof(path), "%s/.local/share", home);
+		bases_add(path);
+	}
+
+	env = getenv("XDG_DATA_DIRS");
+	dirs = strdup(env && env[0] ? env : "/usr/local/share:/usr/share");
+	for (token = strtok_r(dirs, ":", &saveptr); token != NULL;
+	     token = strtok_r(NULL, ":", &saveptr))
+		bases_add(token);
+	free(dirs);
+}
+
+static int64_t dir_mtime(const char *path)
+{
+	struct stat st;
+
+	if (stat(path, &st) == -1)
+		return -1;
+
+	return st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+}
+
+static uint32_t builder_string(struct builder *b, const char *str)
+{
+	size_t len = strlen(str) + 1;
+	uint32_t offset = b->strings_size;
+	char *strings;
+
+	if (b->strings_size + len > b->strings_alloc) {
+		b->strings_alloc = (b->strings_alloc + len) * 2;
+		strings = realloc(b->strings, b->strings_alloc);
+		if (strings == NULL)
+			return 0;
+		b->strings = strings;
+	}
+
+	memcpy(b->strings + offset, str, len);
+	b->strings_size += len;
+
+	return offset;
+}
+
+static uint32_t builder_dir(struct builder *b, const char *path)
+{
+	struct cache_dir *dirs;
+
+	dirs = realloc(b->dirs, (b->dirs_count + 1) * sizeof(*dirs));
+	if (dirs == NULL)
+		return 0;
+	b->dirs = dirs;
+
+	dirs[b->dirs_count].mtime = dir_mtime(path);
+	dirs[b->dirs_count].path = builder_string(b, path);
+	dirs[b->dirs_count].pad = 0;
+
+	return b->dirs_count++;
+}
+
+static void builder_candidate(struct builder *b, const char *name,
+			      size_t len, uint32_t dir, int rank, int distance)
+{
+	struct candidate *candidates, *candidate;
+	size_t alloc;
+
+	if (b->candidates_count == b->candidates_alloc) {
+		b->candidates_alloc = (b->candidates_alloc + 64) * 2;
+		alloc = b->candidates_alloc * sizeof(*candidates);
+		candidates = realloc(b->candidates, alloc);
+		if (candidates == NULL)
+			return;
+		b->candidates = candidates;
+	}
+
+	candidate = &b->candidates[b->candidates_count];
+	candidate->name = strndup(name, len);
+	if (candidate->name == NULL)
+		return;
+	b->candidates_count++;
+	candidate->dir = dir;
+	candidate->rank = rank;
+	candidate->distance = distance;
+}
+
+static void builder_scan(struct builder *b, const char *path, int rank,
+			 int distance)
+{
+	struct dirent *entry;
+	uint32_t index;
+	size_t len;
+	DIR *dir;
+
+	/* missing sub directories are covered by the stamp of the theme */
+	dir = opendir(path);
+	if (dir == NULL)
+		return;
+	index = builder_dir(b, path);
+
+	/* cairo only decodes PNG */
+	while ((entry = readdir(dir)) != NULL) {
+		len = strlen(entry->d_name);
+		if (len > 4 && strcmp(entry->d_name + len - 4, ".png") == 0)
+			builder_candidate(b, entry->d_name, len - 4, index,
+					  rank, distance);
+	}
+
+	closedir(dir);
+}
+
+static void builder_free(struct builder *b)
+{
+	size_t i;
+
+	for (i = 0; i < b->candidates_count; i++)
+		free(b->candidates[i].name);
+	free(b->candidates);
+	free(b->dirs);
+	free(b->strings);
+}
+
+static int dir_distance(struct theme_dir *dir, int size)
+{
+	switch (dir->type) {
+	case DIR_FIXED:
+		return abs(dir->size - size);
+	case DIR_SCALABLE:
+		if (size < dir->min)
+			return dir->min - size;
+		if (size > dir->max)
+			return size - dir->max;
+		return 0;
+	default:
+		if (size < dir->size - dir->threshold)
+			return dir->size - dir->threshold - size;
+		if (size > dir->size + dir->threshold)
+			return size - dir->size - dir->threshold;
+		return 0;
+	}
+}
+
+static void theme_dirs_free(struct theme_dir *dirs, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+		free(dirs[i].name);
+	free(dirs);
+}
+
+static int theme_dirs_parse(char *value, struct theme_dir **dirs)
+{
+	char *token, *saveptr;
+	int count = 0;
+
+	for (token = strtok_r(value, ",", &saveptr); token != NULL;
+	     token = strtok_r(NULL, ",", &saveptr)) {
+		*dirs = realloc(*dirs, (count + 1) * sizeof(struct theme_dir));
+		(*dirs)[count] = (struct theme_dir){strdup(token), 0, -1, -1,
+						    2, 1, DIR_THRESHOLD};
+		count++;
+	}
+
+	return count;
+}
+
+static void theme_dir_set(struct theme_dir *dir, const char *line)
+{
+	if (strncmp(line, "Size=", 5) == 0)
+		dir->size = atoi(line + 5);
+	else if (strncmp(line, "MinSize=", 8) == 0)
+		dir->min = atoi(line + 8);
+	else if (strncmp(line, "MaxSize=", 8) == 0)
+		dir->max = atoi(line + 8);
+	else if (strncmp(line, "Threshold=", 10) == 0)
+		dir->threshold = atoi(line + 10);
+	else if (strncmp(line, "Scale=", 6) == 0)
+		dir->scale = atoi(line + 6);
+	else if (strcmp(line, "Type=Fixed") == 0)
+		dir->type = DIR_FIXED;
+	else if (strcmp(line, "Type=Scalable") == 0)
+		dir->type = DIR_SCALABLE;
+}
+
+/* index.theme found first in the base directories describes the theme */
+static int theme_parse(const char *theme, struct theme_dir **dirs,
+		       char *inherits, size_t len)
+{
+	struct theme_dir *current = NULL;
+	char path[PATH_MAX], line[4096];
+	bool in_theme = false;
+	FILE *fp = NULL;
+	int i, count = 0;
+
+	for (i = 0; i < bases_count && fp == NULL; i++) {
+		snprintf(path, sizeof(path), "%s/%s/index.theme", bases[i],
+			 theme);
+		fp = fopen(path, "r");
+	}
+	if (fp == NULL)
+		return -1;
+
+	while (fgets(line, sizeof(line), fp) != NULL) {
+		line[strcspn(line, "\r\n")] = '\0';
+
+		if (line[0] == '[') {
+			line[strcspn(line, "]")] = '\0';
+			in_theme = strcmp(line + 1, "Icon Theme") == 0;
+			current = NULL;
+			for (i = 0; i < count && !in_theme; i++)
+				if (strcmp((*dirs)[i].name, line + 1) == 0)
+					current = &(*dirs)[i];
+			continue;
+		}
+
+		if (in_theme && strncmp(line, "Inherits=", 9) == 0)
+			snprintf(inherits, len, "%s", line + 9);
+		else if (in_theme && strncmp(line, "Directories=", 12) == 0
+			 && count == 0)
+			count = theme_dirs_parse(line + 12, dirs);
+		else if (current != NULL)
+			theme_dir_set(current, line);
+	}
+	fclose(fp);
+
+	for (i = 0; i < count; i++) {
+		if ((*dirs)[i].min == -1)
+			(*dirs)[i].min = (*dirs)[i].size;
+		if ((*dirs)[i].max == -1)
+			(*dirs)[i].max = (*dirs)[i].size;
+	}
+
+	return count;
+}
+
+static void builder_theme(struct builder *b, const char *theme, int rank,
+			  char *inherits, size_t len)
+{
+	struct theme_dir *dirs = NULL;
+	char root[PATH_MAX], path[PATH_MAX];
+	struct stat st;
+	int i, j, count;
+
+	inherits[0] = '\0';
+	count = theme_parse(theme, &dirs, inherits, len);
+	if (count == -1) {
+		LOGW("Icon theme %s not found", theme);
+		return;
+	}
+
+	/* the theme may be spread over several base directories */
+	for (i = 0; i < bases_count; i++) {
+		snprintf(root, sizeof(root), "%s/%s", bases[i], theme);
+		builder_dir(b, root);
+		if (stat(root, &st) == -1)
+			continue;
+
+		for (j = 0; j < count; j++) {
+			if (dirs[j].scale != 1
+			    || snprintf(path, sizeof(path), "%s/%s", root,
+					dirs[j].name)
+				       >= (int)sizeof(path))
+				continue;
+
+			builder_scan(b, path, rank,
+				     dir_distance(&dirs[j], b->size));
+		}
+	}
+
+	theme_dirs_free(dirs, count);
+}
+
+static void chain_add(char chain[][256], int *count, const char *theme)
+{
+	int i;
+
+	if (*count == ICONTHEME_CHAIN_MAX || theme[0] == '\0')
+		return;
+
+	for (i = 0; i < *count; i++)
+		if (strcmp(chain[i], theme) == 0)
+			return;
+
+	snprintf(chain[(*count)++], 256, "%s", theme);
+}
+
+static void builder_chain(struct builder *b, const char *theme)
+{
+	char chain[ICONTHEME_CHAIN_MAX][256], inherits[1024];
+	char *token, *saveptr;
+	int i, count = 0;
+
+	/* new base or theme directories invalidate the cache */
+	for (i = 0; i < bases_count; i++)
+		builder_dir(b, bases[i]);
+
+	chain_add(chain, &count, theme);
+	for (i = 0; i < count; i++) {
+		builder_theme(b, chain[i], i, inherits, sizeof(inherits));
+
+		for (token = strtok_r(inherits, ",", &saveptr); token != NULL;
+		     token = strtok_r(NULL, ",", &saveptr))
+			chain_add(chain, &count, token + strspn(token, " "));
+
+		/* hicolor is the implicit parent of every theme */
+		if (i == count - 1)
+			chain_add(chain, &count, "hicolor");
+	}
+
+	/* unthemed icons come last */
+	builder_scan(b, ICONTHEME_PIXMAPS, count, 0);
+}
+
+static int candidate_cmp(const void *a, const void *b)
+{
+	const struct candidate *ca = a, *cb = b;
+	int ret = strcmp(ca->name, cb->name);
+
+	if (ret != 0)
+		return ret;
+	if (ca->rank != cb->rank)
+		return ca->rank - cb->rank;
+	return ca->distance - cb->distance;
+}
+
+static bool builder_write(struct builder *b, const char *path)
+{
+	struct cache_header hdr = {.magic = ICONTHEME_MAGIC,
+				   .version = ICONTHEME_VERSION};
+	struct cache_entry *entries;
+	char tmp[PATH_MAX];
+	size_t i, count = 0;
+	bool ret = false;
+	FILE *fp;
+
+	/* best candidate of each name comes first */
+	qsort(b->candidates, b->candidates_count, sizeof(struct candidate),
+	      candidate_cmp);
+
+	entries = malloc((b->candidates_count + 1) * sizeof(*entries));
+	if (entries == NULL)
+		return false;
+
+	for (i = 0; i < b->candidates_count; i++) {
+		if (i > 0
+		    && strcmp(b->candidates[i].name, b->candidates[i - 1].name)
+			       == 0)
+			continue;
+
+		entries[count].name = builder_string(b, b->candidates[i].name);
+		entries[count].dir = b->candidates[i].dir;
+		count++;
+	}
+
+	hdr.size = b->size;
+	hdr.bases_count = bases_count;
+	hdr.dirs_count = b->dirs_count;
+	hdr.entries_count = count;
+	hdr.strings_size = b->strings_size;
+
+	/* replaced at once, a mapping of the old file stays valid */
+	snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+	fp = fopen(tmp, "w");
+	if (fp != NULL) {
+		ret = fwrite(&hdr, sizeof(hdr), 1, fp) == 1
+		      && fwrite(b->dirs, sizeof(*b->dirs), b->dirs_count, fp)
+				 == b->dirs_count
+		      && fwrite(entries, sizeof(*entries), count, fp) == count
+		      && fwrite(b->strings, 1, b->strings_size, fp)
+				 == b->strings_size;
+		ret = (fclose(fp) == 0) && ret && rename(tmp, path) == 0;
+	}
+
+	if (ret == false) {
+		LOGW("Cannot write icon index %s", path);
+		unlink(tmp);
+	}
+
+	free(entries);
+	return ret;
+}
+
+static void cache_unmap(void)
+{
+	if (cache_map != NULL)
+		munmap(cache_map, cache_len);
+
+	cache_map = NULL;
+	cache_len = 0;
+	header = NULL;
+}
+
+static bool cache_valid(void)
+{
+	const char *path;
+	uint32_t i;
+
+	for (i = 0; i < header->entries_count; i++)
+		if (cache_entries[i].name >= header->strings_size
+		    || cache_entries[i].dir >= header->dirs_count)
+			return false;
+
+	/* $XDG_DATA_DIRS may have changed */
+	if (header->bases_count != (uint32_t)bases_count
+	    || header->dirs_count < header->bases_count)
+		return false;
+
+	for (i = 0; i < header->dirs_count; i++) {
+		if (cache_dirs[i].path >= header->strings_size)
+			return false;
+		path = cache_strings + cache_dirs[i].path;
+
+		if (i < header->bases_count && strcmp(path, bases[i]) != 0)
+			return false;
+
+		if (dir_mtime(path) != cache_dirs[i].mtime)
+			return false;
+	}
+
+	return true;
+}
+
+static bool cache_load(const char *path, int size)
+{
+	const char *base;
+	struct stat st;
+	size_t len;
+	void *map;
+	int fd;
+
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd == -1)
+		return false;
+
+	if (fstat(fd, &st) == -1 || st.st_size < (off_t)sizeof(*header)) {
+		close(fd);
+		return false;
+	}
+
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	close(fd);
+	if (map == MAP_FAILED)
+		return false;
+
+	cache_map = map;
+	cache_len = st.st_size;
+	header = map;
+
+	/* sections sizes must add up to the file size */
+	len = sizeof(*header) + header->dirs_count * sizeof(struct cache_dir)
+	      + header->entries_count * sizeof(struct cache_entry)
+	      + header->strings_size;
+	if (memcmp(header->magic, ICONTHEME_MAGIC, 4) != 0
+	    || header->version != ICONTHEME_VERSION
+	    || header->size != (uint32_t)size || len != cache_len
+	    || header->strings_size == 0) {
+		cache_unmap();
+		return false;
+	}
+
+	base = (const char *)map + sizeof(*header);
+	cache_dirs = (const struct cache_dir *)base;
+	base += header->dirs_count * sizeof(struct cache_dir);
+	cache_entries = (const struct cache_entry *)base;
+	base += header->entries_count * sizeof(struct cache_entry);
+	cache_strings = base;
+
+	if (cache_strings[header->strings_size - 1] != '\0'
+	    || cache_valid() == false) {
+		cache_unmap();
+		return false;
+	}
+
+	return true;
+}
+
+bool icontheme_init(const char *theme, int size)
+{
+	struct builder b = {.size = size};
+	char path[PATH_MAX], name[NAME_MAX];
+	bool ret;
+
+	icontheme_exit();
+
+	if (theme == NULL || strchr(theme, '/') != NULL)
+		return false;
+
+	snprintf(name, sizeof(name), "icons-%s-%d", theme, size);
+	if (cache_path(path, sizeof(path), name) == false)
+		return false;
+
+	bases_init();
+	ret = cache_load(path, size);
+	if (ret == false) {
+		LOGI("Building icon index of %s for %dpx", theme, size);
+		builder_chain(&b, theme);
+		ret = builder_write(&b, path) && cache_load(path, size);
+		builder_free(&b);
+	}
+	bases_clear();
+
+	return ret;
+}
+
+bool icontheme_lookup(const char *name, char *path, size_t len)
+{
+	const struct cache_entry *entry;
+	uint32_t low = 0, high, middle;
+	int ret;
+
+	if (cache_map == NULL)
+		return false;
+
+	high = header->entries_count;
+	while (low < high) {
+		middle = low + (high - low) / 2;
+		entry = &cache_entries[middle];
+
+		ret = strcmp(name, cache_strings + entry->name);
+		if (ret == 0) {
+			snprintf(path, len, "%s/%s.png",
+				 cache_strings + cache_dirs[entry->dir].path,
+				 name);
+			return true;
+		}
+
+		if (ret < 0)
+			high = middle;
+		else
+			low = middle + 1;
+	}
+
+	return false;
+}
+
+void icontheme_exit(void)
+{
+	cache_unmap();
+}
@@ -0,0 +1,34 @@
+/*
+ * This file is part of the jwm distribution:
+ * https://github.com/JulienMasson/jwm
+ *
+ * Copyright (c) 2017 Julien Masson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef ICONTHEME_H
+#define ICONTHEME_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* index the icons of the theme (and its parents) for one size */
+bool icontheme_init(const char *theme, int size);
+
+/* path of the PNG icon, without any filesystem access */
+bool icontheme_lookup(const char *name, char *path, size_t len);
+
+void icontheme_exit(void);
+
+#endif
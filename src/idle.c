@@ -0,0 +1,117 @@
+/*
+ * This file is part of the jwm distribution:
+ * https://github.com/JulienMasson/jwm
+ *
+ * Copyright (c) 2017 Julien Masson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdlib.h>
+#include <time.h>
+
+#include "idle.h"
+#include "list.h"
+#include "log.h"
+
+struct idle_task {
+	idle_func_t func;
+	void *data;
+};
+
+static struct list *idle_head = NULL;
+static struct timespec deadline;
+
+static struct list *idle_find(idle_func_t func, void *data)
+{
+	struct idle_task *task;
+	struct list *index;
+
+	for (index = idle_head; index != NULL; index = index->next) {
+		task = index->data;
+
+		if (task->func == func && task->data == data)
+			return index;
+	}
+
+	return NULL;
+}
+
+void idle_add(idle_func_t func, void *data)
+{
+	struct idle_task *task;
+
+	/* already queued, it will see the latest state when it runs */
+	if (idle_find(func, data) != NULL)
+		return;
+
+	task = malloc(sizeof(struct idle_task));
+	if (task == NULL) {
+		LOGE("Fail to queue idle task");
+		return;
+	}
+
+	task->func = func;
+	task->data = data;
+	if (list_add(&idle_head, task) == NULL)
+		free(task);
+}
+
+void idle_remove(idle_func_t func, void *data)
+{
+	list_remove(&idle_head, idle_find(func, data));
+}
+
+bool idle_pending(void)
+{
+	return idle_head != NULL;
+}
+
+bool idle_expired(void)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+
+	if (now.tv_sec != deadline.tv_sec)
+		return now.tv_sec > deadline.tv_sec;
+	return now.tv_nsec >= deadline.tv_nsec;
+}
+
+void idle_run(void)
+{
+	struct idle_task *task;
+	idle_func_t func;
+	void *data;
+
+	clock_gettime(CLOCK_MONOTONIC, &deadline);
+	deadline.tv_nsec += IDLE_BUDGET_MS * 1000000L;
+	if (deadline.tv_nsec >= 1000000000L) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000L;
+	}
+
+	while (idle_head != NULL) {
+		/* dequeue first, the task may queue itself again */
+		task = idle_head->data;
+		func = task->func;
+		data = task->data;
+		list_remove(&idle_head, idle_head);
+
+		/* not finished, resume after the other tasks */
+		if (func(data) == IDLE_AGAIN)
+			idle_add(func, data);
+
+		if (idle_expired())
+			break;
+	}
+}
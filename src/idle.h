@@ -0,0 +1,41 @@
+/*
+ * This file is part of the jwm distribution:
+ * https://github.com/JulienMasson/jwm
+ *
+ * Copyright (c) 2017 Julien Masson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef IDLE_H
+#define IDLE_H
+
+#include <stdbool.h>
+
+/* time slice given to idle tasks each time the X queue is empty */
+#define IDLE_BUDGET_MS 4
+
+enum idle_status { IDLE_DONE, IDLE_AGAIN };
+
+typedef enum idle_status (*idle_func_t)(void *data);
+
+void idle_add(idle_func_t func, void *data);
+
+void idle_remove(idle_func_t func, void *data);
+
+bool idle_pending(void);
+
+bool idle_expired(void);
+
+void idle_run(void);
+
+#endif
@@ -18,14 +18,20 @@
  */
 
 #include <stdbool.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
 #include <xcb/xcb_keysyms.h>
 #include <X11/keysym.h>
+#include <X11/XF86keysym.h>
 
 #include "global.h"
 #include "utils.h"
 #include "action.h"
 #include "input.h"
 #include "client.h"
+#include "conf.h"
+#include "log.h"
 
 /* Super/Windows key */
 #define MOD XCB_MOD_MASK_4
@@ -47,89 +53,646 @@ static Button buttons[] = {
 	{MOD, XCB_BUTTON_INDEX_3, mouse_motion, {.i = WIN_RESIZE}},
 };
 
-/* wrapper to get xcb keycodes from keysymbol */
-static xcb_keycode_t *xcb_get_keycodes(xcb_keysym_t keysym)
+/* modifiers names accepted in the conf */
+static const struct {
+	const char *name;
+	unsigned int mask;
+} modifiers[] = {
+	{"Mod", MOD},
+	{"Super", MOD},
+	{"Shift", SHIFT},
+	{"Control", CONTROL},
+	{"Ctrl", CONTROL},
+	{"Alt", XCB_MOD_MASK_1},
+	{"Lock", XCB_MOD_MASK_LOCK},
+	{"Mod1", XCB_MOD_MASK_1},
+	{"Mod2", XCB_MOD_MASK_2},
+	{"Mod3", XCB_MOD_MASK_3},
+	{"Mod4", XCB_MOD_MASK_4},
+	{"Mod5", XCB_MOD_MASK_5},
+};
+
+/* keys names accepted in the conf, beside single characters and F1..F35 */
+static const struct {
+	const char *name;
+	xcb_keysym_t keysym;
+} keysym_names[] = {
+	{"Return", XK_Return},
+	{"Tab", XK_Tab},
+	{"Escape", XK_Escape},
+	{"space", XK_space},
+	{"BackSpace", XK_BackSpace},
+	{"Delete", XK_Delete},
+	{"Insert", XK_Insert},
+	{"Home", XK_Home},
+	{"End", XK_End},
+	{"Prior", XK_Prior},
+	{"Next", XK_Next},
+	{"Left", XK_Left},
+	{"Right", XK_Right},
+	{"Up", XK_Up},
+	{"Down", XK_Down},
+	{"Print", XK_Print},
+	{"XF86AudioRaiseVolume", XF86XK_AudioRaiseVolume},
+	{"XF86AudioLowerVolume", XF86XK_AudioLowerVolume},
+	{"XF86AudioMute", XF86XK_AudioMute},
+	{"XF86MonBrightnessUp", XF86XK_MonBrightnessUp},
+	{"XF86MonBrightnessDown", XF86XK_MonBrightnessDown},
+};
+
+/* actions available in the conf, with their parameters */
+struct action_param {
+	const char *name;
+	int8_t value;
+};
+
+static const struct action_param focus_params[] = {
+	{"next", CLIENT_NEXT}, {"previous", CLIENT_PREVIOUS}, {NULL, 0}};
+
+static const struct action_param half_params[] = {
+	{"right", MAXHALF_VERTICAL_RIGHT},
+	{"left", MAXHALF_VERTICAL_LEFT},
+	{NULL, 0}};
+
+static const struct action_param maximize_params[] = {
+	{"one", FULLSCREEN_ONE_MONITOR},
+	{"all", FULLSCREEN_ALL_MONITOR},
+	{NULL, 0}};
+
+static const struct action_param motion_params[] = {
+	{"move", WIN_MOVE}, {"resize", WIN_RESIZE}, {NULL, 0}};
+
+static const struct {
+	const char *name;
+	void (*func)(const Arg *);
+	const struct action_param *params;
+} actions[] = {
+	{"change_focus", change_focus, focus_params},
+	{"max_half", max_half, half_params},
+	{"delete_window", delete_window, NULL},
+	{"maximize", maximize, maximize_params},
+	{"hide", hide, NULL},
+	{"raise_all", raise_all, NULL},
+	{"reload_conf", reload_conf, NULL},
+	{"panel_toggle", panel_toggle, NULL},
+	{"start", start, NULL},
+	{"launcher", launcher, NULL},
+	{"jwm_exit", jwm_exit, NULL},
+	{"mouse_motion", mouse_motion, motion_params},
+	/* remove a default binding */
+	{"none", NULL, NULL},
+};
+
+/* keyboard mapping, kept for the process lifetime */
+static xcb_key_symbols_t *keysyms = NULL;
+
+/* bindings attached to a keycode */
+struct key_entry {
+	unsigned int mod;
+	key *key;
+};
+
+struct key_slot {
+	struct key_entry *entries;
+	uint8_t count;
+};
+
+/* keycode to bindings dispatch table */
+static struct key_slot keymap[UINT8_MAX + 1];
+
+/* bindings compiled from the conf */
+static key **conf_keys = NULL;
+static unsigned int conf_keys_count = 0;
+static Button **conf_buttons = NULL;
+static unsigned int conf_buttons_count = 0;
+
+/* bindings in use: conf bindings and defaults not overridden */
+static key **active_keys = NULL;
+static unsigned int active_keys_count = 0;
+static Button **active_buttons = NULL;
+static unsigned int active_buttons_count = 0;
+
+static unsigned int parse_modifier(const char *name)
 {
-	xcb_key_symbols_t *keysyms;
-	xcb_keycode_t *keycode;
+	unsigned int i;
 
-	if (!(keysyms = xcb_key_symbols_alloc(conn)))
+	for (i = 0; i < LENGTH(modifiers); i++)
+		if (strcmp(name, modifiers[i].name) == 0)
+			return modifiers[i].mask;
+
+	return 0;
+}
+
+/* split "Mod+Shift+e" in a modifiers mask and the last name */
+static bool parse_combo(char *combo, unsigned int *mod, char **name)
+{
+	char *token, *saveptr = NULL;
+	unsigned int mask;
+
+	*mod = 0;
+	*name = NULL;
+
+	for (token = strtok_r(combo, "+", &saveptr); token != NULL;
+	     token = strtok_r(NULL, "+", &saveptr)) {
+		if (*name != NULL) {
+			mask = parse_modifier(*name);
+			if (mask == 0)
+				return false;
+			*mod |= mask;
+		}
+		*name = token;
+	}
+
+	return *name != NULL;
+}
+
+static xcb_keysym_t parse_keysym(const char *name)
+{
+	unsigned int i, f;
+
+	/* printable characters are their own keysym */
+	if (strlen(name) == 1)
+		return (unsigned char)name[0];
+
+	for (i = 0; i < LENGTH(keysym_names); i++)
+		if (strcmp(name, keysym_names[i].name) == 0)
+			return keysym_names[i].keysym;
+
+	if (sscanf(name, "F%u", &f) == 1 && f >= 1 && f <= 35)
+		return XK_F1 + f - 1;
+
+	if (strncmp(name, "0x", 2) == 0)
+		return strtoul(name, NULL, 16);
+
+	return XCB_NO_SYMBOL;
+}
+
+static unsigned int parse_button(const char *name)
+{
+	unsigned int button = 0;
+
+	if (sscanf(name, "Button%u", &button) != 1)
+		sscanf(name, "%u", &button);
+
+	return button <= XCB_BUTTON_INDEX_5 ? button : 0;
+}
+
+static bool parse_action(struct conf_binding *binding,
+			 void (**func)(const Arg *), Arg *arg)
+{
+	const struct action_param *param;
+	unsigned int i;
+
+	for (i = 0; i < LENGTH(actions); i++) {
+		if (strcmp(binding->action, actions[i].name) != 0)
+			continue;
+
+		*func = actions[i].func;
+		*arg = (Arg){.i = 0};
+
+		/* start take the command line */
+		if (*func == start) {
+			arg->com = command_parse(binding->arg);
+			return arg->com != NULL;
+		}
+
+		if (actions[i].params == NULL)
+			return true;
+
+		for (param = actions[i].params; param->name != NULL; param++) {
+			if (strcmp(binding->arg, param->name) == 0) {
+				arg->i = param->value;
+				return true;
+			}
+		}
+		return false;
+	}
+
+	return false;
+}
+
+static key *compile_key(struct conf_binding *binding)
+{
+	char combo[strlen(binding->combo) + 1];
+	void (*func)(const Arg *);
+	unsigned int mod;
+	xcb_keysym_t keysym;
+	char *name;
+	key *compiled;
+	Arg arg;
+
+	snprintf(combo, sizeof(combo), "%s", binding->combo);
+	if (parse_combo(combo, &mod, &name) == false)
+		return NULL;
+
+	keysym = parse_keysym(name);
+	if (keysym == XCB_NO_SYMBOL)
+		return NULL;
+
+	if (parse_action(binding, &func, &arg) == false)
 		return NULL;
 
-	keycode = xcb_key_symbols_get_keycode(keysyms, keysym);
-	xcb_key_symbols_free(keysyms);
+	compiled = malloc(sizeof(key));
+	if (compiled == NULL)
+		return NULL;
+	memcpy(compiled, &(key){mod, keysym, func, arg}, sizeof(key));
 
-	return keycode;
+	return compiled;
 }
 
-/* wrapper to get xcb keysymbol from keycode */
-static xcb_keysym_t xcb_get_keysym(xcb_keycode_t keycode)
+static Button *compile_button(struct conf_binding *binding)
 {
-	xcb_key_symbols_t *keysyms;
+	char combo[strlen(binding->combo) + 1];
+	void (*func)(const Arg *);
+	unsigned int mod, index;
+	Button *button;
+	char *name;
+	Arg arg;
 
-	if (!(keysyms = xcb_key_symbols_alloc(conn)))
-		return 0;
+	snprintf(combo, sizeof(combo), "%s", binding->combo);
+	if (parse_combo(combo, &mod, &name) == false)
+		return NULL;
 
-	xcb_keysym_t keysym = xcb_key_symbols_get_keysym(keysyms, keycode, 0);
-	xcb_key_symbols_free(keysyms);
+	index = parse_button(name);
+	if (index == 0)
+		return NULL;
 
-	return keysym;
+	if (parse_action(binding, &func, &arg) == false)
+		return NULL;
+
+	button = malloc(sizeof(Button));
+	if (button == NULL)
+		return NULL;
+	memcpy(button, &(Button){mod, index, func, arg}, sizeof(Button));
+
+	return button;
 }
 
-bool input_init(void)
+static void free_bindings(key **keys, unsigned int keys_count,
+			  Button **buttons, unsigned int buttons_count)
 {
+	unsigned int i;
+
+	for (i = 0; i < keys_count; i++) {
+		if (keys[i]->func == start)
+			command_free(keys[i]->arg.com);
+		free(keys[i]);
+	}
+	free(keys);
+
+	for (i = 0; i < buttons_count; i++) {
+		if (buttons[i]->func == start)
+			command_free(buttons[i]->arg.com);
+		free(buttons[i]);
+	}
+	free(buttons);
+}
+
+static void compile_conf_bindings(void)
+{
+	struct conf_binding *binding;
+	struct list *index;
+	Button *button;
+	key *compiled;
+
+	conf_keys = NULL;
+	conf_keys_count = 0;
+	conf_buttons = NULL;
+	conf_buttons_count = 0;
+
+	for (index = global_conf.keys; index != NULL; index = index->next) {
+		binding = index->data;
+		compiled = compile_key(binding);
+		if (compiled == NULL) {
+			LOGW("Invalid key binding: %s %s %s", binding->combo,
+			     binding->action, binding->arg);
+			continue;
+		}
+		conf_keys = realloc(conf_keys,
+				    (conf_keys_count + 1) * sizeof(*conf_keys));
+		conf_keys[conf_keys_count++] = compiled;
+	}
+
+	for (index = global_conf.buttons; index != NULL; index = index->next) {
+		binding = index->data;
+		button = compile_button(binding);
+		if (button == NULL) {
+			LOGW("Invalid button binding: %s %s %s",
+			     binding->combo, binding->action, binding->arg);
+			continue;
+		}
+		conf_buttons =
+			realloc(conf_buttons,
+				(conf_buttons_count + 1) * sizeof(Button *));
+		conf_buttons[conf_buttons_count++] = button;
+	}
+}
+
+static bool key_overridden(key *binding)
+{
+	unsigned int i;
+
+	for (i = 0; i < conf_keys_count; i++)
+		if (conf_keys[i]->mod == binding->mod
+		    && conf_keys[i]->keysym == binding->keysym)
+			return true;
+
+	return false;
+}
+
+static bool button_overridden(Button *button)
+{
+	unsigned int i;
+
+	for (i = 0; i < conf_buttons_count; i++)
+		if (conf_buttons[i]->mask == button->mask
+		    && conf_buttons[i]->button == button->button)
+			return true;
+
+	return false;
+}
+
+/* merge defaults and conf bindings, "none" actions are dropped */
+static void active_bindings_build(void)
+{
+	unsigned int i;
+
+	free(active_keys);
+	active_keys = malloc((LENGTH(keys) + conf_keys_count) * sizeof(key *));
+	active_keys_count = 0;
+
+	for (i = 0; i < LENGTH(keys); i++)
+		if (key_overridden(&keys[i]) == false)
+			active_keys[active_keys_count++] = &keys[i];
+	for (i = 0; i < conf_keys_count; i++)
+		if (conf_keys[i]->func != NULL)
+			active_keys[active_keys_count++] = conf_keys[i];
+
+	free(active_buttons);
+	active_buttons = malloc((LENGTH(buttons) + conf_buttons_count)
+				* sizeof(Button *));
+	active_buttons_count = 0;
+
+	for (i = 0; i < LENGTH(buttons); i++)
+		if (button_overridden(&buttons[i]) == false)
+			active_buttons[active_buttons_count++] = &buttons[i];
+	for (i = 0; i < conf_buttons_count; i++)
+		if (conf_buttons[i]->func != NULL)
+			active_buttons[active_buttons_count++] =
+				conf_buttons[i];
+}
+
+static void keymap_add(struct key_slot *slot, key *binding)
+{
+	struct key_entry *entries;
+
+	entries = realloc(slot->entries,
+			  (slot->count + 1) * sizeof(struct key_entry));
+	if (entries == NULL)
+		return;
+
+	entries[slot->count].mod = binding->mod;
+	entries[slot->count].key = binding;
+	slot->entries = entries;
+	slot->count++;
+}
+
+static bool keymap_has(struct key_slot *slot, unsigned int mod)
+{
+	uint8_t i;
+
+	for (i = 0; i < slot->count; i++)
+		if (slot->entries[i].mod == mod)
+			return true;
+
+	return false;
+}
+
+/* resolve active bindings to keycodes, only issue the grabs that changed */
+static void keymap_build(void)
+{
+	struct key_slot old[LENGTH(keymap)];
 	xcb_keycode_t *keycode;
-	uint8_t i, k;
+	unsigned int i, k;
+	uint8_t e;
 
-	/* release any key combination on root windows */
-	xcb_ungrab_key(conn, XCB_GRAB_ANY, screen->root, XCB_MOD_MASK_ANY);
+	memcpy(old, keymap, sizeof(keymap));
+	memset(keymap, 0, sizeof(keymap));
 
-	/* grab key on root windows */
-	for (i = 0; i < LENGTH(keys); i++) {
-		keycode = xcb_get_keycodes(keys[i].keysym);
+	for (i = 0; i < active_keys_count; i++) {
+		keycode = xcb_key_symbols_get_keycode(keysyms,
+						      active_keys[i]->keysym);
+		if (keycode == NULL)
+			continue;
 
 		for (k = 0; keycode[k] != XCB_NO_SYMBOL; k++)
-			xcb_grab_key(conn, 1, screen->root, keys[i].mod,
-				     keycode[k], XCB_GRAB_MODE_ASYNC,
-				     XCB_GRAB_MODE_ASYNC);
+			keymap_add(&keymap[keycode[k]], active_keys[i]);
 		free(keycode);
 	}
 
+	for (k = 0; k < LENGTH(keymap); k++) {
+		for (e = 0; e < old[k].count; e++)
+			if (keymap_has(&keymap[k], old[k].entries[e].mod)
+			    == false)
+				xcb_ungrab_key(conn, k, screen->root,
+					       old[k].entries[e].mod);
+
+		for (e = 0; e < keymap[k].count; e++)
+			if (keymap_has(&old[k], keymap[k].entries[e].mod)
+			    == false)
+				xcb_grab_key(conn, 1, screen->root,
+					     keymap[k].entries[e].mod, k,
+					     XCB_GRAB_MODE_ASYNC,
+					     XCB_GRAB_MODE_ASYNC);
+
+		free(old[k].entries);
+	}
+}
+
+static void keymap_clear(void)
+{
+	unsigned int k;
+
+	for (k = 0; k < LENGTH(keymap); k++) {
+		free(keymap[k].entries);
+		keymap[k].entries = NULL;
+		keymap[k].count = 0;
+	}
+}
+
+static bool buttons_has(Button **set, unsigned int count, Button *button)
+{
+	unsigned int i;
+
+	for (i = 0; i < count; i++)
+		if (set[i]->mask == button->mask
+		    && set[i]->button == button->button)
+			return true;
+
+	return false;
+}
+
+struct buttons_diff {
+	Button **old;
+	unsigned int old_count;
+};
+
+/* only issue the button grabs that changed on this client */
+static void buttons_regrab(struct client *client, void *data)
+{
+	struct buttons_diff *diff = data;
+	unsigned int i;
+
+	for (i = 0; i < diff->old_count; i++)
+		if (buttons_has(active_buttons, active_buttons_count,
+				diff->old[i])
+		    == false)
+			xcb_ungrab_button(conn, diff->old[i]->button,
+					  client->id, diff->old[i]->mask);
+
+	for (i = 0; i < active_buttons_count; i++)
+		if (buttons_has(diff->old, diff->old_count, active_buttons[i])
+		    == false)
+			xcb_grab_button(conn, 1, client->id,
+					XCB_EVENT_MASK_BUTTON_PRESS,
+					XCB_GRAB_MODE_ASYNC,
+					XCB_GRAB_MODE_ASYNC, screen->root,
+					XCB_NONE, active_buttons[i]->button,
+					active_buttons[i]->mask);
+}
+
+bool input_init(void)
+{
+	keysyms = xcb_key_symbols_alloc(conn);
+	if (keysyms == NULL)
+		return false;
+
+	/* release any key combination on root windows */
+	xcb_ungrab_key(conn, XCB_GRAB_ANY, screen->root, XCB_MOD_MASK_ANY);
+
+	compile_conf_bindings();
+	active_bindings_build();
+	keymap_build();
+
 	return true;
 }
 
-/* setup the given windows to listen to button events (presses / releases) */
+void input_reload(void)
+{
+	struct buttons_diff diff;
+	key **old_keys = conf_keys;
+	Button **old_buttons = conf_buttons;
+	unsigned int old_keys_count = conf_keys_count;
+	unsigned int old_buttons_count = conf_buttons_count;
+
+	LOGI("Reload bindings");
+
+	/* keep the previous button set to diff against */
+	diff.old = active_buttons;
+	diff.old_count = active_buttons_count;
+	active_buttons = NULL;
+
+	/* compile the new conf and apply it */
+	compile_conf_bindings();
+	active_bindings_build();
+	keymap_build();
+	client_foreach(buttons_regrab, &diff);
+	xcb_flush(conn);
+
+	/* previous bindings are not referenced anymore */
+	free(diff.old);
+	free_bindings(old_keys, old_keys_count, old_buttons,
+		      old_buttons_count);
+}
+
+void input_exit(void)
+{
+	keymap_clear();
+	free_bindings(conf_keys, conf_keys_count, conf_buttons,
+		      conf_buttons_count);
+	conf_keys = NULL;
+	conf_keys_count = 0;
+	conf_buttons = NULL;
+	conf_buttons_count = 0;
+
+	free(active_keys);
+	active_keys = NULL;
+	active_keys_count = 0;
+	free(active_buttons);
+	active_buttons = NULL;
+	active_buttons_count = 0;
+
+	if (keysyms != NULL) {
+		xcb_key_symbols_free(keysyms);
+		keysyms = NULL;
+	}
+}
+
+/* setup the given windows to listen to button events (presses / releases),
+ * done once when the window is mapped and updated by input_reload() */
 void input_grab_buttons(xcb_window_t grab_window)
 {
 	unsigned int b;
 
-	for (b = 0; b < LENGTH(buttons); b++)
-		xcb_grab_button(
-			conn, 1, grab_window, XCB_EVENT_MASK_BUTTON_PRESS,
-			XCB_GRAB_MODE_ASYNC, XCB_GRAB_MODE_ASYNC, screen->root,
-			XCB_NONE, buttons[b].button, buttons[b].mask);
+	for (b = 0; b < active_buttons_count; b++)
+		xcb_grab_button(conn, 1, grab_window,
+				XCB_EVENT_MASK_BUTTON_PRESS,
+				XCB_GRAB_MODE_ASYNC, XCB_GRAB_MODE_ASYNC,
+				screen->root, XCB_NONE,
+				active_buttons[b]->button,
+				active_buttons[b]->mask);
 }
 
 void input_key_handler(xcb_key_press_event_t *ev)
 {
-	unsigned int i;
-	xcb_keysym_t keysym = xcb_get_keysym(ev->detail);
+	struct key_slot *slot = &keymap[ev->detail];
+	key *binding;
+	uint8_t i;
 
-	for (i = 0; i < LENGTH(keys); i++) {
-		if (keys[i].func && keys[i].keysym == keysym
-		    && keys[i].mod == ev->state) {
-			keys[i].func(&keys[i].arg);
+	for (i = 0; i < slot->count; i++) {
+		binding = slot->entries[i].key;
+		if (binding->func && slot->entries[i].mod == ev->state) {
+			binding->func(&binding->arg);
 			break;
 		}
 	}
 }
 
+xcb_keysym_t input_get_keysym(xcb_keycode_t keycode, uint16_t state)
+{
+	xcb_keysym_t keysym = XCB_NO_SYMBOL;
+
+	/* shifted symbol if any, plain one otherwise */
+	if (state & XCB_MOD_MASK_SHIFT)
+		keysym = xcb_key_symbols_get_keysym(keysyms, keycode, 1);
+	if (keysym == XCB_NO_SYMBOL)
+		keysym = xcb_key_symbols_get_keysym(keysyms, keycode, 0);
+
+	return keysym;
+}
+
+void input_mapping_handler(xcb_mapping_notify_event_t *ev)
+{
+	if (ev->request == XCB_MAPPING_POINTER)
+		return;
+
+	/* keyboard layout changed, refresh keysyms and keycodes */
+	xcb_refresh_keyboard_mapping(keysyms, ev);
+	keymap_build();
+	xcb_flush(conn);
+}
+
 void input_button_handler(xcb_button_press_event_t *ev)
 {
+	Button *button;
 	unsigned int i;
 
-	for (i = 0; i < LENGTH(buttons); i++)
-		if (buttons[i].func && buttons[i].button == ev->detail
-		    && buttons[i].mask == ev->state)
-			buttons[i].func(&(buttons[i].arg));
+	for (i = 0; i < active_buttons_count; i++) {
+		button = active_buttons[i];
+		if (button->func && button->button == ev->detail
+		    && button->mask == ev->state) {
+			button->func(&button->arg);
+			break;
+		}
+	}
 }
@@ -34,10 +34,18 @@ typedef struct {
 
 bool input_init(void);
 
+void input_reload(void);
+
+void input_exit(void);
+
 void input_grab_buttons(xcb_window_t grab_window);
 
 void input_key_handler(xcb_key_press_event_t *ev);
 
 void input_button_handler(xcb_button_press_event_t *ev);
 
+void input_mapping_handler(xcb_mapping_notify_event_t *ev);
+
+xcb_keysym_t input_get_keysym(xcb_keycode_t keycode, uint16_t state);
+
 #endif
@@ -31,6 +31,16 @@
 #include "conf.h"
 #include "cursor.h"
 #include "panel.h"
+#include "shadow.h"
+#include "metrics.h"
+#include "timer.h"
+#include "spawner.h"
+#include "pool.h"
+#include "rules.h"
+#include "utils.h"
+#include "launcher.h"
+#include "icontheme.h"
+#include "process.h"
 #include <xcb/xcb_aux.h>
 
 /* global vars */
@@ -40,15 +50,42 @@ xcb_visualtype_t *visual; /* Visual type */
 
 void cleanup(void)
 {
+	metrics_dump();
+	spawner_exit();
+	pool_exit();
+	rules_exit();
+	launcher_exit();
 	ewmh_exit();
+	input_exit();
+	timer_exit();
+	regex_cache_clear();
+	draw_icon_cache_clear();
+	icontheme_exit();
+	process_exit();
 	xcb_set_input_focus(conn, XCB_NONE, XCB_INPUT_FOCUS_POINTER_ROOT,
 			    XCB_CURRENT_TIME);
 	xcb_flush(conn);
 	xcb_disconnect(conn);
 }
 
+static void timer_event(void __attribute__((__unused__)) * data)
+{
+	timer_run();
+}
+
 static bool init(int scrno)
 {
+	/* signals go through a signalfd, block them before any thread */
+	event_block_signals();
+
+	/* init timers, expired from the main loop */
+	if (!timer_init())
+		return false;
+	event_add_fd(timer_get_fd(), timer_event, NULL);
+
+	/* icon theme index, before anything draws icons */
+	icontheme_init(global_conf.icon_theme, PANEL_ICON_SIZE);
+
 	/* init all monitors */
 	monitor_init();
 
@@ -61,6 +98,9 @@ static bool init(int scrno)
 		return false;
 	}
 
+	/* mirror windows existing before us */
+	shadow_init();
+
 	/* ewmh init */
 	ewmh_init(scrno);
 
@@ -74,6 +114,15 @@ static bool init(int scrno)
 	/* init cursor */
 	cursor_init();
 
+	/* window rules, matched at map time */
+	rules_reload();
+
+	/* pre-started instances, filled when idle */
+	pool_init();
+
+	/* application launcher and its index */
+	launcher_init();
+
 	return true;
 }
 
@@ -121,6 +170,10 @@ int main(int argc, char **argv)
 	conf_init(conf_file);
 	log_init();
 
+	/* launcher helper, forked while we are still small */
+	if (!spawner_init())
+		LOGW("No launcher helper, fallback on fork");
+
 	/* call cleanup on normal process termination */
 	atexit(cleanup);
 
@@ -0,0 +1,305 @@
+/*
+ * This file is part of the jwm distribution:
+ * https://github.com/JulienMasson/jwm
+ *
+ * Copyright (c) 2017 Julien Masson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <limits.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <X11/keysym.h>
+#include <cairo/cairo-xcb.h>
+
+#include "global.h"
+#include "launcher.h"
+#include "action.h"
+#include "appindex.h"
+#include "client.h"
+#include "draw.h"
+#include "event.h"
+#include "icontheme.h"
+#include "input.h"
+#include "log.h"
+#include "metrics.h"
+#include "monitor.h"
+#include "panel.h"
+#include "utils.h"
+#include "window.h"
+
+#define LAUNCHER_FONT "sans 11"
+#define LAUNCHER_WIDTH 480
+#define LAUNCHER_LINES 10
+#define LAUNCHER_LINE_HEIGHT 24
+#define LAUNCHER_HEIGHT ((LAUNCHER_LINES + 1) * LAUNCHER_LINE_HEIGHT)
+#define LAUNCHER_QUERY_MAX 128
+#define LAUNCHER_ICON_SIZE 20
+
+struct launcher {
+	xcb_window_t win;
+	cairo_surface_t *src;
+	struct draw_t *draw;
+	bool active;
+	char query[LAUNCHER_QUERY_MAX];
+	size_t len;
+	int selected;
+	struct app *results[LAUNCHER_LINES];
+	int count;
+	unsigned int generation; /* of the index the results point to */
+};
+
+static struct launcher launcher_popup = {XCB_NONE, NULL, NULL, false, "",
+					 0,	0,    {NULL}, 0,     0};
+
+static void launcher_inotify(void __attribute__((__unused__)) * data)
+{
+	appindex_event();
+}
+
+static void launcher_draw_icon(struct app *app, double y)
+{
+	struct launcher *l = &launcher_popup;
+	char path[PATH_MAX];
+	struct area_t area = {10, y, LAUNCHER_ICON_SIZE, LAUNCHER_ICON_SIZE};
+
+	if (app->icon[0] == '/')
+		snprintf(path, sizeof(path), "%s", app->icon);
+	else if (icontheme_lookup(app->icon, path, sizeof(path)) == false)
+		return;
+
+	draw_icon(l->draw, path, area);
+}
+
+static void launcher_update(void)
+{
+	struct launcher *l = &launcher_popup;
+
+	l->count = appindex_query(l->query, l->results, LAUNCHER_LINES);
+	l->generation = appindex_generation();
+	if (l->selected >= l->count)
+		l->selected = l->count > 0 ? l->count - 1 : 0;
+}
+
+static void launcher_draw(void)
+{
+	struct launcher *l = &launcher_popup;
+	char prompt[LAUNCHER_QUERY_MAX + 3];
+	struct area_t area;
+	int i;
+
+	/* background and border */
+	area = (struct area_t){0, 0, LAUNCHER_WIDTH, LAUNCHER_HEIGHT};
+	draw_set_color(l->draw, BLACK);
+	draw_rectangle(l->draw, area, true);
+	area = (struct area_t){0.5, 0.5, LAUNCHER_WIDTH - 1,
+			       LAUNCHER_HEIGHT - 1};
+	draw_set_color(l->draw, ORANGE);
+	draw_rectangle(l->draw, area, false);
+
+	/* query */
+	snprintf(prompt, sizeof(prompt), "> %s", l->query);
+	area = (struct area_t){10, 3, LAUNCHER_WIDTH - 20, 0};
+	draw_text(l->draw, prompt, strlen(prompt), area);
+
+	/* results freed by a rebuild of the index, query again */
+	if (l->generation != appindex_generation())
+		launcher_update();
+
+	/* matches */
+	for (i = 0; i < l->count; i++) {
+		launcher_draw_icon(l->results[i],
+				   (i + 1) * LAUNCHER_LINE_HEIGHT + 2);
+		area = (struct area_t){40, (i + 1) * LAUNCHER_LINE_HEIGHT + 3,
+				       LAUNCHER_WIDTH - 50, 0};
+		draw_set_color(l->draw, i == l->selected ? ORANGE : GREY);
+		draw_text(l->draw, l->results[i]->name,
+			  strlen(l->results[i]->name), area);
+	}
+	draw_set_color(l->draw, BLACK);
+
+	cairo_surface_flush(l->src);
+	xcb_flush(conn);
+}
+
+static void launcher_hide(void)
+{
+	struct launcher *l = &launcher_popup;
+
+	xcb_ungrab_keyboard(conn, XCB_CURRENT_TIME);
+	window_unmap(l->win);
+	l->active = false;
+}
+
+static void launcher_run(void)
+{
+	struct launcher *l = &launcher_popup;
+	struct app *app;
+	Arg arg;
+
+	/* the index may have been rebuilt since the last frame */
+	launcher_update();
+	if (l->count == 0)
+		return;
+
+	app = l->results[l->selected];
+	arg.com = command_parse(app->exec);
+	if (arg.com != NULL) {
+		start(&arg);
+		command_free(arg.com);
+	}
+	appindex_launched(app);
+}
+
+void launcher_init(void)
+{
+	struct launcher *l = &launcher_popup;
+	char path[PATH_MAX];
+
+	if (cache_path(path, sizeof(path), "launcher"))
+		appindex_init(path);
+	else
+		appindex_init(NULL);
+
+	if (appindex_get_fd() != -1)
+		event_add_fd(appindex_get_fd(), launcher_inotify, NULL);
+
+	/* created once, only mapped while in use */
+	l->win = window_create(0, 0, LAUNCHER_WIDTH, LAUNCHER_HEIGHT);
+	l->src = cairo_xcb_surface_create(conn, l->win, visual,
+					  LAUNCHER_WIDTH, LAUNCHER_HEIGHT);
+	l->draw = draw_create(l->src, LAUNCHER_FONT);
+}
+
+void launcher_show(void)
+{
+	struct launcher *l = &launcher_popup;
+	struct panel *panel = panel_get();
+	struct client *focus = client_get_focus();
+	xcb_grab_keyboard_cookie_t cookie;
+	xcb_grab_keyboard_reply_t *reply;
+	int16_t x, y;
+
+	if (l->active || l->win == XCB_NONE)
+		return;
+
+	/* under the panel, on the monitor of the focus */
+	x = (focus && focus->monitor) ? focus->monitor->x : panel->x;
+	y = panel->enable ? panel->y + panel->height : panel->y;
+
+	cookie = xcb_grab_keyboard(conn, 1, screen->root, XCB_CURRENT_TIME,
+				   XCB_GRAB_MODE_ASYNC, XCB_GRAB_MODE_ASYNC);
+	reply = xcb_grab_keyboard_reply(conn, cookie, NULL);
+	if (reply == NULL || reply->status != XCB_GRAB_STATUS_SUCCESS) {
+		LOGW("Cannot grab the keyboard for the launcher");
+		free(reply);
+		return;
+	}
+	free(reply);
+
+	l->active = true;
+	l->query[0] = '\0';
+	l->len = 0;
+	l->selected = 0;
+	launcher_update();
+
+	window_move(l->win, x, y);
+	window_show(l->win);
+	window_raise(l->win);
+	launcher_draw();
+}
+
+bool launcher_active(void)
+{
+	return launcher_popup.active;
+}
+
+void launcher_key(xcb_key_press_event_t *ev)
+{
+	struct launcher *l = &launcher_popup;
+	struct timespec start, end;
+	xcb_keysym_t keysym;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	keysym = input_get_keysym(ev->detail, ev->state);
+
+	switch (keysym) {
+	case XK_Escape:
+		launcher_hide();
+		return;
+	case XK_Return:
+	case XK_KP_Enter:
+		launcher_hide();
+		launcher_run();
+		return;
+	case XK_BackSpace:
+		if (l->len > 0)
+			l->query[--l->len] = '\0';
+		l->selected = 0;
+		break;
+	case XK_Up:
+	case XK_ISO_Left_Tab:
+		if (l->selected > 0)
+			l->selected--;
+		break;
+	case XK_Down:
+	case XK_Tab:
+		if (l->selected < l->count - 1)
+			l->selected++;
+		break;
+	default:
+		/* printable latin-1 keysyms are their character */
+		if (keysym < 0x20 || keysym > 0x7e
+		    || l->len == LAUNCHER_QUERY_MAX - 1)
+			return;
+		l->query[l->len++] = keysym;
+		l->query[l->len] = '\0';
+		l->selected = 0;
+		break;
+	}
+
+	launcher_update();
+	launcher_draw();
+
+	/* keystroke to frame */
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	metrics_inc(METRIC_LAUNCHER_FRAME);
+	metrics_add(METRIC_LAUNCHER_FRAME_US,
+		    (end.tv_sec - start.tv_sec) * 1000000L
+			    + (end.tv_nsec - start.tv_nsec) / 1000L);
+}
+
+void launcher_expose(xcb_expose_event_t *ev)
+{
+	if (launcher_popup.active && ev->window == launcher_popup.win
+	    && ev->count == 0)
+		launcher_draw();
+}
+
+void launcher_exit(void)
+{
+	struct launcher *l = &launcher_popup;
+
+	if (l->win == XCB_NONE)
+		return;
+
+	if (appindex_get_fd() != -1)
+		event_remove_fd(appindex_get_fd());
+	appindex_exit();
+
+	draw_destroy(l->draw);
+	cairo_surface_destroy(l->src);
+	xcb_destroy_window(conn, l->win);
+	l->win = XCB_NONE;
+}
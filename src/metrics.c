@@ -0,0 +1,73 @@
+/*
+ * This file is part of the jwm distribution:
+ * https://github.com/JulienMasson/jwm
+ *
+ * Copyright (c) 2017 Julien Masson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include "metrics.h"
+#include "log.h"
+#include "conf.h"
+
+static const char *metric_names[METRIC_LAST] = {
+	[METRIC_ENTER_SUPPRESSED] = "enter_suppressed",
+	[METRIC_CHILD_EXITED] = "child_exited",
+	[METRIC_CHILD_FAILED] = "child_failed",
+	[METRIC_SPAWN] = "spawn",
+	[METRIC_SPAWN_LATENCY_US] = "spawn_latency_us",
+	[METRIC_LAUNCHER_FRAME] = "launcher_frame",
+	[METRIC_LAUNCHER_FRAME_US] = "launcher_frame_us",
+	[METRIC_TEXT_SHAPED] = "text_shaped",
+	[METRIC_TEXT_CACHED] = "text_cached",
+	[METRIC_TEXT_SHAPE_US] = "text_shape_us",
+	[METRIC_TEXT_CONTEXT] = "text_context",
+	[METRIC_PANEL_REPAINT] = "panel_repaint",
+	[METRIC_PANEL_REQUESTS] = "panel_requests",
+};
+
+static uint64_t metrics[METRIC_LAST];
+
+void metrics_inc(enum metric metric)
+{
+	metrics_add(metric, 1);
+}
+
+void metrics_add(enum metric metric, uint64_t value)
+{
+	/* also counted from the widgets thread */
+	if (metric < METRIC_LAST)
+		__atomic_add_fetch(&metrics[metric], value, __ATOMIC_RELAXED);
+}
+
+uint64_t metrics_get(enum metric metric)
+{
+	if (metric < METRIC_LAST)
+		return __atomic_load_n(&metrics[metric], __ATOMIC_RELAXED);
+
+	return 0;
+}
+
+bool metrics_enabled(void)
+{
+	return global_conf.log_level >= LOG_INFO;
+}
+
+void metrics_dump(void)
+{
+	int i;
+
+	for (i = 0; i < METRIC_LAST; i++)
+		LOGI("metric %s: %llu", metric_names[i],
+		     (unsigned long long)metrics[i]);
+}
@@ -0,0 +1,53 @@
+/*
+ * This file is part of the jwm distribution:
+ * https://github.com/JulienMasson/jwm
+ *
+ * Copyright (c) 2017 Julien Masson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+enum metric {
+	METRIC_ENTER_SUPPRESSED,
+	METRIC_CHILD_EXITED,
+	METRIC_CHILD_FAILED,
+	METRIC_SPAWN,
+	METRIC_SPAWN_LATENCY_US,
+	METRIC_LAUNCHER_FRAME,
+	METRIC_LAUNCHER_FRAME_US,
+	METRIC_TEXT_SHAPED,
+	METRIC_TEXT_CACHED,
+	METRIC_TEXT_SHAPE_US,
+	METRIC_TEXT_CONTEXT,
+	METRIC_PANEL_REPAINT,
+	METRIC_PANEL_REQUESTS,
+	METRIC_LAST
+};
+
+void metrics_inc(enum metric metric);
+
+void metrics_add(enum metric metric, uint64_t value);
+
+uint64_t metrics_get(enum metric metric);
+
+/* the dump is logged at info level, costly metrics are only taken then */
+bool metrics_enabled(void);
+
+void metrics_dump(void);
+
+#endif
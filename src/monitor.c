@@ -29,6 +29,9 @@
 #include "utils.h"
 #include "conf.h"
 #include "panel.h"
+#include "cursor.h"
+#include "idle.h"
+#include "log.h"
 
 /* list of all monitor */
 struct list *monitors_head;
@@ -132,6 +135,29 @@ struct monitor *monitor_find_by_coord(const int16_t x, const int16_t y)
 	return monitors_head->data;
 }
 
+struct monitor *monitor_find(const char *name)
+{
+	struct monitor *mon;
+	struct list *index;
+	char *end;
+	long number;
+	int i = 1;
+
+	/* output name or its number, starting at 1 */
+	number = strtol(name, &end, 10);
+	if (*end != '\0')
+		number = 0;
+
+	for (index = monitors_head; index != NULL; index = index->next, i++) {
+		mon = index->data;
+
+		if (i == number || strcmp(mon->name, name) == 0)
+			return mon;
+	}
+
+	return NULL;
+}
+
 static struct monitor *monitor_get_first_from_head(void)
 {
 	struct monitor *monitor = NULL;
@@ -242,59 +268,132 @@ static void monitor_handle_output(xcb_randr_output_t id,
 	}
 }
 
-void monitor_set_wallpaper(void)
+/* wallpaper is painted from the idle queue, one stage at a time */
+enum wallpaper_stage { WALLPAPER_LOAD, WALLPAPER_PAINT, WALLPAPER_APPLY };
+
+struct wallpaper {
+	enum wallpaper_stage stage;
+	xcb_pixmap_t pixmap;
+	cairo_surface_t *src;
+	cairo_surface_t *dest;
+	cairo_t *cr;
+	struct list *mon;
+};
+
+static struct wallpaper wallpaper = {WALLPAPER_LOAD, XCB_NONE, NULL, NULL,
+				     NULL, NULL};
+
+static void wallpaper_reset(void)
 {
-	struct monitor *mon;
-	struct list *index;
-	float scale_width, scale_height;
+	if (wallpaper.cr != NULL)
+		cairo_destroy(wallpaper.cr);
+	if (wallpaper.dest != NULL)
+		cairo_surface_destroy(wallpaper.dest);
+	if (wallpaper.src != NULL)
+		cairo_surface_destroy(wallpaper.src);
+	if (wallpaper.pixmap != XCB_NONE)
+		xcb_free_pixmap(conn, wallpaper.pixmap);
+
+	wallpaper.stage = WALLPAPER_LOAD;
+	wallpaper.pixmap = XCB_NONE;
+	wallpaper.src = wallpaper.dest = NULL;
+	wallpaper.cr = NULL;
+	wallpaper.mon = NULL;
+}
+
+static bool wallpaper_load(void)
+{
+	uint16_t width = screen->width_in_pixels;
+	uint16_t height = screen->height_in_pixels;
 
 	/* check if we can access wallpaper path */
 	if ((global_conf.wallpaper == NULL)
 	    || (file_access(global_conf.wallpaper) == false))
-		return;
-
-	/* create a pixmap  */
-	xcb_pixmap_t p = xcb_generate_id(conn);
-	uint16_t width = screen->width_in_pixels;
-	uint16_t height = screen->height_in_pixels;
-	xcb_create_pixmap(conn, screen->root_depth, p, screen->root, width,
-			  height);
+		return false;
 
 	/* create surface from png file */
-	cairo_surface_t *src =
+	wallpaper.src =
 		cairo_image_surface_create_from_png(global_conf.wallpaper);
-	int image_height = cairo_image_surface_get_height(src);
-	int image_width = cairo_image_surface_get_width(src);
+	if (cairo_surface_status(wallpaper.src) != CAIRO_STATUS_SUCCESS) {
+		LOGE("Fail to load wallpaper %s", global_conf.wallpaper);
+		return false;
+	}
 
-	/* loop through monitors and paint the scaled image */
-	cairo_surface_t *dest =
-		cairo_xcb_surface_create(conn, p, visual, width, height);
-	cairo_t *cr = cairo_create(dest);
-	for (index = monitors_head; index != NULL; index = index->next) {
-		mon = index->data;
+	/* create a pixmap  */
+	wallpaper.pixmap = xcb_generate_id(conn);
+	xcb_create_pixmap(conn, screen->root_depth, wallpaper.pixmap,
+			  screen->root, width, height);
+	wallpaper.dest = cairo_xcb_surface_create(conn, wallpaper.pixmap,
+						  visual, width, height);
+	wallpaper.cr = cairo_create(wallpaper.dest);
+	wallpaper.mon = monitors_head;
+
+	return true;
+}
 
-		scale_width = ((float)mon->width) / ((float)image_width);
-		scale_height = ((float)mon->height) / ((float)image_height);
+static void wallpaper_paint(struct monitor *mon)
+{
+	float scale_width, scale_height;
+	int image_height = cairo_image_surface_get_height(wallpaper.src);
+	int image_width = cairo_image_surface_get_width(wallpaper.src);
 
-		cairo_scale(cr, scale_width, scale_height);
-		cairo_set_source_surface(cr, src, mon->x / scale_width,
-					 mon->y / scale_height);
-		cairo_paint(cr);
-		cairo_scale(cr, 1 / scale_width, 1 / scale_height);
-	}
-	cairo_surface_flush(dest);
+	scale_width = ((float)mon->width) / ((float)image_width);
+	scale_height = ((float)mon->height) / ((float)image_height);
+
+	cairo_scale(wallpaper.cr, scale_width, scale_height);
+	cairo_set_source_surface(wallpaper.cr, wallpaper.src,
+				 mon->x / scale_width, mon->y / scale_height);
+	cairo_paint(wallpaper.cr);
+	cairo_scale(wallpaper.cr, 1 / scale_width, 1 / scale_height);
+}
+
+static void wallpaper_apply(void)
+{
+	cairo_surface_flush(wallpaper.dest);
 
 	/* change root window background pixmap */
 	xcb_change_window_attributes(conn, screen->root, XCB_CW_BACK_PIXMAP,
-				     &p);
+				     &wallpaper.pixmap);
 	xcb_clear_area(conn, 0, screen->root, 0, 0, 0, 0);
 	xcb_flush(conn);
+}
 
-	/* free resources */
-	xcb_free_pixmap(conn, p);
-	cairo_surface_destroy(src);
-	cairo_surface_destroy(dest);
-	cairo_destroy(cr);
+static enum idle_status wallpaper_task(void __attribute__((__unused__))
+				       * data)
+{
+	switch (wallpaper.stage) {
+	case WALLPAPER_LOAD:
+		if (wallpaper_load() == false) {
+			wallpaper_reset();
+			return IDLE_DONE;
+		}
+		wallpaper.stage = WALLPAPER_PAINT;
+		if (idle_expired())
+			return IDLE_AGAIN;
+		/* fall through */
+	case WALLPAPER_PAINT:
+		/* one monitor at a time, until the budget is spent */
+		while (wallpaper.mon != NULL) {
+			wallpaper_paint(wallpaper.mon->data);
+			wallpaper.mon = wallpaper.mon->next;
+			if (wallpaper.mon != NULL && idle_expired())
+				return IDLE_AGAIN;
+		}
+		wallpaper.stage = WALLPAPER_APPLY;
+		/* fall through */
+	case WALLPAPER_APPLY:
+		wallpaper_apply();
+		wallpaper_reset();
+	}
+
+	return IDLE_DONE;
+}
+
+void monitor_set_wallpaper(void)
+{
+	/* restart from scratch, monitors or path may have changed */
+	wallpaper_reset();
+	idle_add(wallpaper_task, NULL);
 }
 
 static void monitor_update(void)
@@ -329,6 +428,9 @@ static void monitor_update(void)
 		}
 	}
 
+	/* outputs changed, the pointer may have been moved */
+	cursor_invalidate_coordinates();
+
 	/* TODO: do we need to do this everytime ???? */
 	panel_update_geom();
 	client_foreach(monitor_check_client, NULL);
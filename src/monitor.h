@@ -38,6 +38,7 @@ void monitor_init(void);
 void monitor_foreach(void (*func)(struct monitor *monitor, void *data),
 		     void *data);
 struct monitor *monitor_find_by_coord(const int16_t x, const int16_t y);
+struct monitor *monitor_find(const char *name);
 void monitor_borders(int16_t *x, int16_t *y, uint16_t *width, uint16_t *height);
 
 /* wallpaper */
@@ -19,7 +19,10 @@
 
 #include <stdio.h>
 #include <string.h>
-#include <libgen.h>
+#include <limits.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
 
 #include "global.h"
 #include "panel.h"
@@ -30,11 +33,30 @@
 #include "log.h"
 #include "widgets.h"
 #include "draw.h"
+#include "launcher.h"
+#include "icontheme.h"
+#include "process.h"
+#include "metrics.h"
+#include "conf.h"
+#include "event.h"
 
 #define PANEL_FONT "sans 12"
-#define PANEL_REFRESH 60
 #define PANEL_TEXT_SIZE 11
 
+/* independent parts of the panel, from left to right */
+enum panel_segment {
+	SEGMENT_TASKS,
+	SEGMENT_WIDGETS,
+	SEGMENT_SYSTRAY,
+	SEGMENT_CLOCK,
+	SEGMENT_LAST
+};
+
+struct segment {
+	struct area_t area;
+	bool dirty;
+};
+
 struct panel_client_data {
 	struct monitor *mon;
 	double *pos;
@@ -45,14 +67,25 @@ struct panel_client {
 	struct client *client;
 	double pos;
 	double width;
+	int width_name;
+	char name[256];
+	bool dirty;
 	struct list *index;
 };
 
 struct panel *panel = NULL;
 struct list *panel_clients_head;
 xcb_window_t *systray = NULL;
+static int clock_fd = -1;
 int systray_count = 0;
 
+/* retained model, a repaint only draws what is dirty */
+static struct segment segments[SEGMENT_LAST];
+static bool layout_dirty = true;
+static cairo_region_t *damage = NULL;
+static char clock_text[256];
+static int clock_width, clock_height;
+
 static struct panel_client *panel_client_add(struct client *client, double pos,
 					     double width)
 {
@@ -70,6 +103,7 @@ static struct panel_client *panel_client_add(struct client *client, double pos,
 	panel_client->client = client;
 	panel_client->pos = pos;
 	panel_client->width = width;
+	panel_client->dirty = true;
 	panel_client->index = index;
 
 	return panel_client;
@@ -90,25 +124,154 @@ static struct panel_client *panel_client_find_by_client(struct client *client)
 	return NULL;
 }
 
-static void panel_client_update(struct client *client, double pos, double width)
+static void panel_surfaces_create(void)
 {
-	struct panel_client *panel_client;
-	struct list *index;
+	int width = panel->width - panel->x;
+	int height = panel->height - panel->y;
+
+	/* composed client side, the window only gets the final image */
+	panel->window = cairo_xcb_surface_create(conn, panel->id, visual,
+						 width, height);
+	panel->src = cairo_image_surface_create(CAIRO_FORMAT_RGB24, width,
+						height);
+	panel->draw = draw_create(panel->src, PANEL_FONT);
+}
 
-	for (index = panel_clients_head; index != NULL; index = index->next) {
-		panel_client = index->data;
+static void panel_surfaces_destroy(void)
+{
+	draw_destroy(panel->draw);
+	cairo_surface_destroy(panel->src);
+	cairo_surface_destroy(panel->window);
+}
 
-		if (client == panel_client->client) {
-			panel_client->pos = pos;
-			panel_client->width = width;
-		}
+/* copy the areas of the offscreen panel to the window, in one request */
+static void panel_upload(const cairo_region_t *region)
+{
+	cairo_rectangle_int_t rect;
+	cairo_t *cr;
+	int i, count;
+
+	count = cairo_region_num_rectangles(region);
+	if (count == 0)
+		return;
+
+	cairo_surface_flush(panel->src);
+
+	cr = cairo_create(panel->window);
+	cairo_set_operator(cr, CAIRO_OPERATOR_SOURCE);
+	cairo_set_source_surface(cr, panel->src, 0, 0);
+	for (i = 0; i < count; i++) {
+		cairo_region_get_rectangle(region, i, &rect);
+		cairo_rectangle(cr, rect.x, rect.y, rect.width, rect.height);
+	}
+	cairo_fill(cr);
+	cairo_destroy(cr);
+
+	cairo_surface_flush(panel->window);
+	xcb_flush(conn);
+}
+
+static void damage_add(struct area_t area)
+{
+	/* panel positions and widths are whole pixels */
+	cairo_rectangle_int_t rect = {area.x, area.y, area.width, area.height};
+
+	cairo_region_union_rectangle(damage, &rect);
+}
+
+/* X requests sent by a repaint, from the sequence numbers of two extra
+ * requests, only when metrics are dumped */
+static unsigned int repaint_begin(void)
+{
+	if (metrics_enabled() == false)
+		return 0;
+
+	return xcb_no_operation(conn).sequence;
+}
+
+static void repaint_end(unsigned int begin)
+{
+	unsigned int end;
+
+	metrics_inc(METRIC_PANEL_REPAINT);
+	if (metrics_enabled() == false)
+		return;
+
+	end = xcb_no_operation(conn).sequence;
+	metrics_add(METRIC_PANEL_REQUESTS, end - begin - 1);
+}
+
+/* the format shows seconds if it changes with them alone */
+static time_t clock_period(void)
+{
+	struct tm tm = {.tm_mday = 1, .tm_year = 100};
+	char a[256], b[256];
+	size_t len_a, len_b;
+
+	len_a = strftime(a, sizeof(a), global_conf.clock_format, &tm);
+	tm.tm_sec = 1;
+	len_b = strftime(b, sizeof(b), global_conf.clock_format, &tm);
+
+	if (len_a != len_b || memcmp(a, b, len_a) != 0)
+		return 1;
+	return 60;
+}
+
+/* wake up on the wall clock boundaries, canceled if the clock is set */
+static void clock_arm(void)
+{
+	int flags = TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET;
+	struct itimerspec its = {0};
+	struct timespec now;
+	time_t period = clock_period();
+
+	clock_gettime(CLOCK_REALTIME, &now);
+	its.it_value.tv_sec = (now.tv_sec / period + 1) * period;
+	its.it_interval.tv_sec = period;
+
+	if (timerfd_settime(clock_fd, flags, &its, NULL) == -1)
+		LOGE("Failed to arm clock timer: %s", strerror(errno));
+}
+
+static void clock_event(void __attribute__((__unused__)) * data)
+{
+	uint64_t expirations;
+
+	if (read(clock_fd, &expirations, sizeof(expirations)) == -1) {
+		if (errno != ECANCELED)
+			return;
+
+		/* CLOCK_REALTIME was set (date, NTP step), align again. A
+		 * timezone change is no jump of this clock, localtime()
+		 * picks it up on the next tick */
+		clock_arm();
+	}
+
+	panel_draw_clock();
+}
+
+static void clock_init(void)
+{
+	clock_fd = timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (clock_fd == -1) {
+		LOGE("Failed to create clock timer: %s", strerror(errno));
+		return;
 	}
+
+	if (event_add_fd(clock_fd, clock_event, NULL) == false) {
+		close(clock_fd);
+		clock_fd = -1;
+		return;
+	}
+
+	clock_arm();
 }
 
 void panel_init(void)
 {
 	int16_t border_x, border_y;
 	uint16_t border_width, border_height;
+	uint32_t values[1];
 
 	monitor_borders(&border_x, &border_y, &border_width, &border_height);
 	panel = malloc(sizeof(struct panel));
@@ -121,13 +284,14 @@ void panel_init(void)
 	panel->width = border_width;
 	panel->height = PANEL_HEIGHT;
 	panel->enable = true;
-	panel->refresh = PANEL_REFRESH;
+
+	/* the server keeps our content, expose only needs an upload */
+	values[0] = XCB_BACKING_STORE_WHEN_MAPPED;
+	xcb_change_window_attributes(conn, panel->id, XCB_CW_BACKING_STORE,
+				     values);
 
 	/* init draw */
-	panel->src = cairo_xcb_surface_create(conn, panel->id, visual,
-					      panel->width - panel->x,
-					      panel->height - panel->y);
-	panel->draw = draw_create(panel->src, PANEL_FONT);
+	panel_surfaces_create();
 
 	/* init systray */
 	char atomname[strlen("_NET_SYSTEM_TRAY_S") + 11];
@@ -170,6 +334,12 @@ void panel_init(void)
 
 	/* init widgets window */
 	widgets_init(panel->id, PANEL_HEIGHT);
+
+	/* first layout and repaint */
+	panel_draw();
+
+	/* clock ticks on the minute, or the second */
+	clock_init();
 }
 
 struct panel *panel_get(void)
@@ -177,6 +347,15 @@ struct panel *panel_get(void)
 	return panel;
 }
 
+void panel_reload(void)
+{
+	/* the clock format may show seconds now */
+	if (clock_fd != -1)
+		clock_arm();
+
+	panel_draw();
+}
+
 void panel_update_geom(void)
 {
 	int16_t border_x, border_y;
@@ -191,15 +370,9 @@ void panel_update_geom(void)
 		panel->y = border_y;
 		panel->width = border_width;
 
-		/* destroy draw */
-		draw_destroy(panel->draw);
-		cairo_surface_destroy(panel->src);
-
-		/* init draw */
-		panel->src = cairo_xcb_surface_create(conn, panel->id, visual,
-						      panel->width - panel->x,
-						      panel->height - panel->y);
-		panel->draw = draw_create(panel->src, PANEL_FONT);
+		/* surfaces of the new size */
+		panel_surfaces_destroy();
+		panel_surfaces_create();
 
 		/* move, resize and show panel */
 		window_move_resize(panel->id, border_x, border_y, border_width,
@@ -208,32 +381,32 @@ void panel_update_geom(void)
 	}
 }
 
-static void draw_clock(double *max_width)
+static void clock_update(void)
 {
 	time_t t;
 	struct tm *lt;
-	char buf_time[256];
-	int width, height;
 
 	/* get current date */
 	t = time(NULL);
 	lt = localtime(&t);
-	buf_time[strftime(buf_time, sizeof(buf_time), "%R  -  %d %b", lt)] =
-		'\0';
+	clock_text[strftime(clock_text, sizeof(clock_text),
+			    global_conf.clock_format, lt)] = '\0';
 
 	/* Get width and height of the text */
-	draw_get_text_prop(panel->draw, buf_time, strlen(buf_time), &width,
-			   &height);
+	draw_get_text_prop(panel->draw, clock_text, strlen(clock_text),
+			   &clock_width, &clock_height);
+	clock_width += 5;
+}
 
-	/* update max width */
-	width += 5;
-	*max_width = panel->width - width;
+static void draw_clock(void)
+{
+	struct area_t *segment = &segments[SEGMENT_CLOCK].area;
 
 	/* draw text */
-	struct area_t area = {*max_width, (PANEL_HEIGHT - height) / 2, width,
-			      panel->height};
+	struct area_t area = {segment->x, (PANEL_HEIGHT - clock_height) / 2,
+			      segment->width, panel->height};
 	draw_set_color(panel->draw, GREY);
-	draw_text(panel->draw, buf_time, strlen(buf_time), area);
+	draw_text(panel->draw, clock_text, strlen(clock_text), area);
 	draw_set_color(panel->draw, BLACK);
 }
 
@@ -257,33 +430,88 @@ static void draw_widgets(double *max_width)
 	}
 }
 
-static void get_icon_path(xcb_window_t win, char *icon_path)
+static void get_icon_name(xcb_window_t win, char *icon_name, size_t len)
 {
 	xcb_get_property_cookie_t cookie;
-	char name[256];
+	const struct process *process = NULL;
 	uint32_t pid;
 
-	/* get pid from the window */
-	memset(name, '\0', 256);
+	/* process owning the window, read once per process */
 	cookie = xcb_ewmh_get_wm_pid(ewmh, win);
 	if (xcb_ewmh_get_wm_pid_reply(ewmh, cookie, &pid, NULL))
-		get_process_name(pid, name, 256);
+		process = process_get(pid);
 
-	/* check access to icon path, fallback on the default */
-	snprintf(icon_path, 256, "%s%s.png", ICONS_DIR, basename(name));
-	if (file_access(icon_path) == false)
-		snprintf(icon_path, 256, "%sdefault.png", ICONS_DIR);
+	snprintf(icon_name, len, "%s", process ? process->name : "");
 }
 
-static void get_window_name(xcb_window_t win, char *name, uint32_t len)
+static bool icon_better(xcb_ewmh_wm_icon_iterator_t *a,
+			xcb_ewmh_wm_icon_iterator_t *b)
+{
+	bool a_fit = a->width >= PANEL_ICON_SIZE;
+	bool b_fit = b->width >= PANEL_ICON_SIZE;
+
+	/* smallest one not smaller than the slot, or the largest */
+	if (a_fit != b_fit)
+		return a_fit;
+	return a_fit ? a->width < b->width : a->width > b->width;
+}
+
+static cairo_surface_t *get_icon(struct client *client)
 {
 	xcb_get_property_cookie_t cookie;
-	xcb_ewmh_get_utf8_strings_reply_t data;
+	xcb_ewmh_get_wm_icon_reply_t icons;
+	xcb_ewmh_wm_icon_iterator_t iter, best;
+	char icon_name[256], icon_path[PATH_MAX];
+	bool found = false;
+
+	if (client->icon_dirty == false)
+		return client->icon;
+	client->icon_dirty = false;
+
+	if (client->icon != NULL) {
+		cairo_surface_destroy(client->icon);
+		client->icon = NULL;
+	}
+
+	cookie = xcb_ewmh_get_wm_icon(ewmh, client->id);
+	if (xcb_ewmh_get_wm_icon_reply(ewmh, cookie, &icons, NULL)) {
+		iter = xcb_ewmh_get_wm_icon_iterator(&icons);
+		for (; iter.rem; xcb_ewmh_get_wm_icon_next(&iter)) {
+			if (iter.width == 0 || iter.height == 0)
+				continue;
+
+			if (!found || icon_better(&iter, &best)) {
+				best = iter;
+				found = true;
+			}
+		}
+
+		/* scaled once, kept until the property changes */
+		if (found)
+			client->icon = draw_icon_from_argb(
+				best.data, best.width, best.height,
+				PANEL_ICON_SIZE);
+		xcb_ewmh_get_wm_icon_reply_wipe(&icons);
+	}
+
+	/* no property, icon named after the process */
+	if (client->icon == NULL) {
+		get_icon_name(client->id, icon_name, sizeof(icon_name));
+		snprintf(icon_path, sizeof(icon_path), "%s%s.png", ICONS_DIR,
+			 icon_name);
+		client->icon = draw_icon_load(icon_path, PANEL_ICON_SIZE);
+	}
+
+	/* then in the icon theme */
+	if (client->icon == NULL
+	    && icontheme_lookup(icon_name, icon_path, sizeof(icon_path)))
+		client->icon = draw_icon_load(icon_path, PANEL_ICON_SIZE);
+
+	if (client->icon == NULL)
+		client->icon = draw_icon_load(ICONS_DIR "default.png",
+					      PANEL_ICON_SIZE);
 
-	cookie = xcb_ewmh_get_wm_name(ewmh, win);
-	if (xcb_ewmh_get_wm_name_reply(ewmh, cookie, &data, NULL)
-	    && data.strings_len < len)
-		strncpy(name, data.strings, data.strings_len);
+	return client->icon;
 }
 
 static int panel_get_text_width(char *text, size_t len)
@@ -293,23 +521,36 @@ static int panel_get_text_width(char *text, size_t len)
 	return width;
 }
 
-static void draw_client(struct client *client, void *data)
+static void draw_task(struct panel_client *panel_client)
 {
-	struct client *focus = client_get_focus();
-	struct panel_client_data *client_data =
-		(struct panel_client_data *)data;
-	char name[256];
-	char icon_path[256];
-	int width_name;
-
-	/* check monitor */
-	if (client->monitor != client_data->mon)
-		return;
+	struct client *client = panel_client->client;
+	bool active = (client == client_get_focus()) && !client->iconic;
+	double pos = panel_client->pos;
+
+	/* rounded rectangle around name */
+	struct area_t rect_area = {pos, 0, panel_client->width, PANEL_HEIGHT};
+	draw_set_color(panel->draw, active ? ORANGE : GREY);
+	draw_rounded_rectangle(panel->draw, rect_area);
+
+	/* draw icon */
+	struct area_t icon_area = {pos + 5, 3, PANEL_ICON_SIZE,
+				   PANEL_ICON_SIZE};
+	draw_surface(panel->draw, get_icon(client), icon_area);
+
+	/* show client name */
+	struct area_t client_area = {pos + 5 + 24 + 5, 4,
+				     panel_client->width_name, 0};
+	draw_set_color(panel->draw, active ? ORANGE : GREY);
+	draw_text(panel->draw, panel_client->name, strlen(panel_client->name),
+		  client_area);
+	draw_set_color(panel->draw, BLACK);
+}
 
-	/* get icon and name of the window */
-	memset(name, '\0', 256);
-	get_window_name(client->id, name, 256);
-	get_icon_path(client->id, icon_path);
+static void task_name(struct client *client, char *name, size_t len)
+{
+	/* get name of the window */
+	memset(name, '\0', len);
+	window_get_name(client->id, name, len);
 
 	/* if window name is too long, add "..." at the end */
 	if (strlen(name) > 20) {
@@ -318,112 +559,267 @@ static void draw_client(struct client *client, void *data)
 		name[19] = '.';
 		name[20] = '\0';
 	}
+}
 
-	/* draw rectangle, icon and name of the process */
-	if (strlen(name) > 0) {
+static void layout_client(struct client *client, void *data)
+{
+	struct panel_client_data *client_data =
+		(struct panel_client_data *)data;
+	struct panel_client *panel_client;
+	char name[256];
+	int width_name;
 
-		width_name = panel_get_text_width(name, strlen(name));
+	/* check monitor, hidden pool instances are not tasks */
+	if (client->monitor != client_data->mon || client->pool != NULL)
+		return;
 
-		/* check if we can draw this client */
-		if ((*client_data->pos + (width_name + 15 + 24)
-		     > *client_data->max_width)
-		    || (*client_data->pos + (width_name + 15 + 24)
-			> client->monitor->width + client->monitor->x))
-			return;
+	task_name(client, name, sizeof(name));
+	if (strlen(name) == 0)
+		return;
+
+	width_name = panel_get_text_width(name, strlen(name));
 
-		/* add in panel clients list */
-		if (panel_client_find_by_client(client) == NULL)
-			panel_client_add(client, *client_data->pos,
+	/* check if we can draw this client */
+	if ((*client_data->pos + (width_name + 15 + 24)
+	     > *client_data->max_width)
+	    || (*client_data->pos + (width_name + 15 + 24)
+		> client->monitor->width + client->monitor->x))
+		return;
+
+	/* add in panel clients list, drawn with the tasks segment */
+	panel_client = panel_client_add(client, *client_data->pos,
 					 width_name + 15 + 24);
-		else
-			panel_client_update(client, *client_data->pos,
-					    width_name + 15 + 24);
-
-		/* rounded rectangle around name */
-		struct area_t rect_area = {*client_data->pos, 0,
-					   width_name + 15 + 24, PANEL_HEIGHT};
-		if ((client == focus) && (client->iconic == false))
-			draw_set_color(panel->draw, ORANGE);
-		else
-			draw_set_color(panel->draw, GREY);
-		draw_rounded_rectangle(panel->draw, rect_area);
-
-		/* shift to display icon */
-		*client_data->pos += 5;
-
-		/* draw icon */
-		struct area_t icon_area = {*client_data->pos, 3, 0, 0};
-		draw_icon(panel->draw, icon_path, icon_area);
-
-		/* shift to show name */
-		*client_data->pos += 24 + 5;
-
-		/* show client name */
-		struct area_t client_area = {*client_data->pos, 4, width_name,
-					     0};
-		if ((client == focus) && (client->iconic == false))
-			draw_set_color(panel->draw, ORANGE);
-		else
-			draw_set_color(panel->draw, GREY);
-		draw_text(panel->draw, name, strlen(name), client_area);
-		draw_set_color(panel->draw, BLACK);
-
-		/* update position if next client */
-		if (client->index->next != NULL)
-			*client_data->pos += width_name + 5 + 4;
-	}
+	if (panel_client == NULL)
+		return;
+
+	panel_client->width_name = width_name;
+	strcpy(panel_client->name, name);
+
+	/* update position if next client */
+	*client_data->pos += 5 + 24 + 5;
+	if (client->index->next != NULL)
+		*client_data->pos += width_name + 5 + 4;
 }
 
-static void draw_by_monitor(struct monitor *mon, void *data)
+static void layout_by_monitor(struct monitor *mon, void *data)
 {
 	struct panel_client_data *client_data =
 		(struct panel_client_data *)data;
 	client_data->mon = mon;
 	*client_data->pos = mon->x + 1;
 
-	/* reset panel_clients_head */
-	struct list *index;
-	for (index = panel_clients_head; index != NULL; index = index->next)
-		list_remove(&panel_clients_head, index);
+	client_foreach(layout_client, (void *)client_data);
+}
 
-	client_foreach(draw_client, (void *)client_data);
+static void segment_set(enum panel_segment id, double x, double width)
+{
+	segments[id].area = (struct area_t){x, 0, width, PANEL_HEIGHT};
+	segments[id].dirty = true;
 }
 
-void panel_draw(void)
+/* place the systray icons then the widgets left of the clock, returns
+ * the width left for the tasks */
+static double layout_right(void)
+{
+	double max_width = segments[SEGMENT_CLOCK].area.x;
+	double right = max_width;
+
+	draw_systray(&max_width);
+	segment_set(SEGMENT_SYSTRAY, max_width, right - max_width);
+
+	right = max_width;
+	draw_widgets(&max_width);
+	segment_set(SEGMENT_WIDGETS, max_width, right - max_width);
+
+	return max_width;
+}
+
+/* rebuild the task buttons from the clients */
+static void layout_tasks(double max_width)
 {
 	double pos = 0;
-	double max_width = 0;
 	struct panel_client_data client_data = {NULL, &pos, &max_width};
 
-	if (panel->enable == true) {
-		/* fill panel black */
-		struct area_t area = {panel->x, panel->y, panel->width,
-				      panel->height};
-		draw_rectangle(panel->draw, area, true);
-
-		/* draw on right of the panel:
-		 *
-		 * .... | widgets | systray | clock |
-		 *
-		 */
-		draw_clock(client_data.max_width);
-		draw_systray(client_data.max_width);
-		draw_widgets(client_data.max_width);
-
-		/* draw clients */
-		monitor_foreach(draw_by_monitor, (void *)&client_data);
-
-		/* flush */
-		cairo_surface_flush(panel->src);
-		xcb_flush(conn);
+	while (panel_clients_head != NULL)
+		list_remove(&panel_clients_head, panel_clients_head);
+
+	monitor_foreach(layout_by_monitor, (void *)&client_data);
+	segment_set(SEGMENT_TASKS, 0, max_width);
+}
+
+/* place the segments and the tasks, all of them are dirty after */
+static void panel_layout(void)
+{
+	/* on right of the panel:
+	 *
+	 * .... | widgets | systray | clock |
+	 *
+	 */
+	clock_update();
+	segment_set(SEGMENT_CLOCK, panel->width - clock_width, clock_width);
+
+	layout_tasks(layout_right());
+
+	layout_dirty = false;
+}
+
+static void draw_tasks(void)
+{
+	struct panel_client *panel_client;
+	struct list *index;
+
+	for (index = panel_clients_head; index != NULL; index = index->next) {
+		panel_client = index->data;
+		draw_task(panel_client);
+		panel_client->dirty = false;
+	}
+}
+
+static void draw_segment(enum panel_segment id)
+{
+	struct area_t area = segments[id].area;
+
+	draw_clip(panel->draw, area);
+	draw_set_color(panel->draw, BLACK);
+	draw_rectangle(panel->draw, area, true);
+
+	switch (id) {
+	case SEGMENT_TASKS:
+		draw_tasks();
+		break;
+	case SEGMENT_CLOCK:
+		draw_clock();
+		break;
+	default:
+		/* widgets and systray are windows above the panel */
+		break;
 	}
+
+	damage_add(area);
+	segments[id].dirty = false;
+}
+
+static void redraw_task(struct panel_client *panel_client)
+{
+	/* the button including its antialiased edges, not its neighbours */
+	struct area_t area = {panel_client->pos - 1, 0,
+			      panel_client->width + 2, PANEL_HEIGHT};
+
+	draw_clip(panel->draw, area);
+	draw_set_color(panel->draw, BLACK);
+	draw_rectangle(panel->draw, area, true);
+	draw_task(panel_client);
+
+	damage_add(area);
+	panel_client->dirty = false;
+}
+
+static void panel_repaint(void)
+{
+	struct panel_client *panel_client;
+	struct list *index;
+	unsigned int begin;
+	int i;
+
+	if (panel->enable == false)
+		return;
+
+	begin = repaint_begin();
+	damage = cairo_region_create();
+
+	if (layout_dirty == true)
+		panel_layout();
+
+	for (i = 0; i < SEGMENT_LAST; i++)
+		if (segments[i].dirty == true)
+			draw_segment(i);
+
+	/* single buttons, the others were drawn with their segment */
+	for (index = panel_clients_head; index != NULL; index = index->next) {
+		panel_client = index->data;
+		if (panel_client->dirty == true)
+			redraw_task(panel_client);
+	}
+	draw_clip_reset(panel->draw);
+
+	/* one copy of the dirty areas to the window */
+	panel_upload(damage);
+	cairo_region_destroy(damage);
+	damage = NULL;
+
+	repaint_end(begin);
+}
+
+void panel_draw(void)
+{
+	layout_dirty = true;
+	panel_repaint();
+}
+
+void panel_draw_clock(void)
+{
+	int width = clock_width;
+
+	/* a wider or narrower clock moves the other segments */
+	clock_update();
+	if (clock_width != width)
+		layout_dirty = true;
+
+	segments[SEGMENT_CLOCK].dirty = true;
+	panel_repaint();
+}
+
+void panel_draw_client(struct client *client)
+{
+	struct panel_client *panel_client;
+	char name[256];
+
+	panel_client = panel_client_find_by_client(client);
+	if (panel_client == NULL)
+		return;
+
+	/* a title of another width moves the next tasks */
+	task_name(client, name, sizeof(name));
+	if (panel_get_text_width(name, strlen(name))
+	    != panel_client->width_name) {
+		if (layout_dirty == false)
+			layout_tasks(segments[SEGMENT_TASKS].area.width);
+		panel_repaint();
+		return;
+	}
+
+	strcpy(panel_client->name, name);
+	panel_client->dirty = true;
+	panel_repaint();
+}
+
+void panel_draw_focus(struct client *old, struct client *new)
+{
+	struct panel_client *panel_client;
+
+	/* only the highlight of these two buttons changed */
+	if (old != NULL && (panel_client = panel_client_find_by_client(old)))
+		panel_client->dirty = true;
+	if (new != NULL && (panel_client = panel_client_find_by_client(new)))
+		panel_client->dirty = true;
+
+	panel_repaint();
 }
 
 void panel_event(xcb_expose_event_t *ev)
 {
-	/* only redraw on last expose event */
-	if ((ev->count == 0) && (ev->window == panel->id))
-		panel_draw();
+	cairo_rectangle_int_t rect = {ev->x, ev->y, ev->width, ev->height};
+	cairo_region_t *region;
+
+	/* popup owned by the panel */
+	launcher_expose(ev);
+
+	/* the offscreen panel is up to date, copy the exposed area */
+	if (ev->window == panel->id) {
+		region = cairo_region_create_rectangle(&rect);
+		panel_upload(region);
+		cairo_region_destroy(region);
+	}
 }
 
 static bool systray_found(xcb_window_t win)
@@ -493,11 +889,22 @@ void panel_add_systray(xcb_client_message_event_t *ev)
 void panel_remove_systray(xcb_unmap_notify_event_t *ev)
 {
 	xcb_window_t win = ev->window;
+	double width = segments[SEGMENT_SYSTRAY].area.width;
+	double max_width;
 
-	if (systray_found(win) == true)
-		systray_remove(win);
+	if (systray_found(win) == false)
+		return;
 
-	panel_draw();
+	systray_remove(win);
+
+	/* the icons left of it shift, the tasks only follow a new width */
+	if (layout_dirty == false) {
+		max_width = layout_right();
+		if (segments[SEGMENT_SYSTRAY].area.width != width)
+			layout_tasks(max_width);
+	}
+
+	panel_repaint();
 }
 
 void panel_click(xcb_button_press_event_t *ev)
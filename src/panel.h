@@ -25,23 +25,29 @@
 #include <pango/pangocairo.h>
 
 #include "draw.h"
+#include "client.h"
 
 #define PANEL_HEIGHT 30
+#define PANEL_ICON_SIZE 24
 
 struct panel {
 	xcb_window_t id;
 	int16_t x, y;
 	uint16_t width, height;
 	bool enable;
-	time_t refresh;
-	cairo_surface_t *src;
+	cairo_surface_t *src;    /* offscreen, composed then uploaded */
+	cairo_surface_t *window; /* surface of the panel window */
 	struct draw_t *draw;
 };
 
 void panel_init(void);
 struct panel *panel_get(void);
 void panel_update_geom(void);
+void panel_reload(void);
 void panel_draw(void);
+void panel_draw_client(struct client *client);
+void panel_draw_clock(void);
+void panel_draw_focus(struct client *old, struct client *new);
 void panel_event(xcb_expose_event_t *ev);
 void panel_add_systray(xcb_client_message_event_t *ev);
 void panel_remove_systray(xcb_unmap_notify_event_t *ev);
@@ -0,0 +1,312 @@
+/*
+ * This file is part of the jwm distribution:
+ * https://github.com/JulienMasson/jwm
+ *
+ * Copyright (c) 2017 Julien Masson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdlib.h>
+#include <string.h>
+
+#include "global.h"
+#include "pool.h"
+#include "conf.h"
+#include "idle.h"
+#include "list.h"
+#include "log.h"
+#include "spawner.h"
+#include "utils.h"
+#include "window.h"
+
+/* Pools keep pre-started instances of start commands hidden as iconic
+ * clients. The binding reveals one and the pool refills when idle.
+ * Instances are matched by _NET_WM_PID, so the command must exec the
+ * program creating the window (no shell wrapper, no client/daemon). */
+
+#define POOL_SIZE_MAX 8
+#define POOL_FAILURES_MAX 3
+
+/* pid slot reserved until the launcher answers */
+#define POOL_PID_WAITING 0
+
+struct pool {
+	char *command;
+	const char **argv;
+	int size;     /* 0 once removed from the conf */
+	int ready;    /* hidden clients captured */
+	int failures; /* instances exited before mapping */
+	int pending;  /* spawned, window not seen yet */
+	pid_t pids[POOL_SIZE_MAX];
+};
+
+static struct list *pools_head = NULL;
+
+static struct pool *pool_find_by_command(const char *command)
+{
+	struct pool *pool;
+	struct list *index;
+
+	for (index = pools_head; index != NULL; index = index->next) {
+		pool = index->data;
+
+		if (strcmp(pool->command, command) == 0)
+			return pool;
+	}
+
+	return NULL;
+}
+
+static struct pool *pool_find_by_argv(const char **argv)
+{
+	struct pool *pool;
+	struct list *index;
+
+	for (index = pools_head; index != NULL; index = index->next) {
+		pool = index->data;
+
+		if (pool->size > 0 && command_equal(pool->argv, argv))
+			return pool;
+	}
+
+	return NULL;
+}
+
+static void pool_spawned(pid_t pid, void *data)
+{
+	struct pool *pool = data;
+	int i;
+
+	for (i = 0; i < pool->pending; i++) {
+		if (pool->pids[i] != POOL_PID_WAITING)
+			continue;
+
+		if (pid == -1) {
+			pool->pids[i] = pool->pids[--pool->pending];
+			pool->failures++;
+		} else
+			pool->pids[i] = pid;
+		return;
+	}
+}
+
+static enum idle_status pool_fill_task(void *data)
+{
+	struct pool *pool = data;
+
+	if (pool->ready + pool->pending >= pool->size)
+		return IDLE_DONE;
+
+	if (pool->failures >= POOL_FAILURES_MAX) {
+		LOGW("Pool for \"%s\" disabled, instances keep failing",
+		     pool->command);
+		return IDLE_DONE;
+	}
+
+	/* one instance per idle slice */
+	pool->pids[pool->pending++] = POOL_PID_WAITING;
+	if (spawner_run(pool->argv, pool_spawned, pool) == false) {
+		pool->pending--;
+		return IDLE_DONE;
+	}
+
+	return IDLE_AGAIN;
+}
+
+static void pool_drain_client(struct client *client, void *data)
+{
+	struct pool *pool = data;
+
+	/* close hidden instances nobody will reveal */
+	if (client->pool == pool) {
+		client->pool = NULL;
+		window_delete(client->id);
+	}
+}
+
+static void pool_drain(struct pool *pool)
+{
+	client_foreach(pool_drain_client, pool);
+	pool->ready = 0;
+}
+
+void pool_init(void)
+{
+	pool_reload();
+}
+
+void pool_reload(void)
+{
+	struct conf_pool *conf_pool;
+	struct pool *pool;
+	struct list *index;
+
+	/* pools are never freed, idle tasks and launcher replies may
+	 * still refer to them: removed ones just get a null size */
+	for (index = pools_head; index != NULL; index = index->next) {
+		pool = index->data;
+		pool->size = 0;
+	}
+
+	for (index = global_conf.pools; index != NULL; index = index->next) {
+		conf_pool = index->data;
+
+		pool = pool_find_by_command(conf_pool->command);
+		if (pool == NULL) {
+			pool = calloc(1, sizeof(struct pool));
+			if (pool == NULL)
+				continue;
+
+			pool->command = strdup(conf_pool->command);
+			pool->argv = command_parse(conf_pool->command);
+			if (pool->argv == NULL
+			    || list_add(&pools_head, pool) == NULL) {
+				command_free(pool->argv);
+				free(pool->command);
+				free(pool);
+				continue;
+			}
+		}
+
+		pool->size = conf_pool->size;
+		if (pool->size > POOL_SIZE_MAX)
+			pool->size = POOL_SIZE_MAX;
+		pool->failures = 0;
+	}
+
+	for (index = pools_head; index != NULL; index = index->next) {
+		pool = index->data;
+
+		if (pool->size == 0)
+			pool_drain(pool);
+		else
+			idle_add(pool_fill_task, pool);
+	}
+}
+
+bool pool_reveal(const char **argv)
+{
+	struct client *client;
+	struct pool *pool;
+
+	pool = pool_find_by_argv(argv);
+	if (pool == NULL)
+		return false;
+
+	/* refill in any case, the caller spawns if none is ready */
+	idle_add(pool_fill_task, pool);
+
+	client = client_get_pooled(pool);
+	if (client == NULL)
+		return false;
+
+	pool->ready--;
+	client->pool = NULL;
+	client_reveal(client);
+
+	return true;
+}
+
+bool pool_capture(struct client *client)
+{
+	xcb_get_property_cookie_t cookie;
+	struct pool *pool;
+	struct list *index;
+	uint32_t pid;
+	int i;
+
+	/* avoid the round trip if no instance is expected */
+	for (index = pools_head; index != NULL; index = index->next) {
+		pool = index->data;
+		if (pool->pending > 0)
+			break;
+	}
+	if (index == NULL)
+		return false;
+
+	cookie = xcb_ewmh_get_wm_pid(ewmh, client->id);
+	if (!xcb_ewmh_get_wm_pid_reply(ewmh, cookie, &pid, NULL))
+		return false;
+
+	for (index = pools_head; index != NULL; index = index->next) {
+		pool = index->data;
+
+		for (i = 0; i < pool->pending; i++) {
+			if (pool->pids[i] != (pid_t)pid)
+				continue;
+
+			pool->pids[i] = pool->pids[--pool->pending];
+
+			/* removed from the conf while starting */
+			if (pool->size == 0) {
+				window_delete(client->id);
+				return false;
+			}
+
+			pool->ready++;
+			pool->failures = 0;
+			client->pool = pool;
+			return true;
+		}
+	}
+
+	return false;
+}
+
+void pool_release(struct client *client)
+{
+	struct pool *pool = client->pool;
+
+	/* hidden instance closed on its own */
+	client->pool = NULL;
+	pool->ready--;
+	idle_add(pool_fill_task, pool);
+}
+
+void pool_child_exited(pid_t pid)
+{
+	struct pool *pool;
+	struct list *index;
+	int i;
+
+	/* instance exited before its window showed up */
+	for (index = pools_head; index != NULL; index = index->next) {
+		pool = index->data;
+
+		for (i = 0; i < pool->pending; i++) {
+			if (pool->pids[i] != pid)
+				continue;
+
+			pool->pids[i] = pool->pids[--pool->pending];
+			pool->failures++;
+			idle_add(pool_fill_task, pool);
+			return;
+		}
+	}
+}
+
+void pool_exit(void)
+{
+	struct pool *pool;
+	struct list *index;
+
+	for (index = pools_head; index != NULL; index = index->next) {
+		pool = index->data;
+		pool_drain(pool);
+		command_free(pool->argv);
+		free(pool->command);
+	}
+
+	while (pools_head != NULL)
+		list_remove(&pools_head, pools_head);
+}
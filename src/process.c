@@ -0,0 +1,193 @@
+/*
+ * This file is part of the jwm distribution:
+ * https://github.com/JulienMasson/jwm
+ *
+ * Copyright (c) 2017 Julien Masson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "process.h"
+#include "event.h"
+#include "list.h"
+#include "log.h"
+
+/* Processes owning our windows, read from /proc the first time one of
+ * their windows needs it. Each entry holds a pidfd watched by the event
+ * loop: the entry is dropped when the process exits, so its pid can't
+ * be reused behind our back. */
+
+#ifndef SYS_pidfd_open
+#define SYS_pidfd_open 434
+#endif
+
+static struct list *processes_head = NULL;
+
+/* entry of the last process we couldn't watch, valid until next call */
+static struct process process_unwatched;
+
+static ssize_t proc_read(pid_t pid, const char *file, char *buf, size_t len)
+{
+	char path[64];
+	ssize_t size;
+	int fd;
+
+	snprintf(path, sizeof(path), "/proc/%d/%s", pid, file);
+	fd = open(path, O_RDONLY | O_CLOEXEC);
+	if (fd == -1)
+		return -1;
+
+	size = read(fd, buf, len - 1);
+	close(fd);
+	if (size < 0)
+		return -1;
+
+	buf[size] = '\0';
+	return size;
+}
+
+static void process_read(struct process *process)
+{
+	char buf[PATH_MAX], path[64], *name;
+	ssize_t size, i;
+
+	/* NUL separated arguments */
+	buf[0] = '\0';
+	size = proc_read(process->pid, "cmdline", buf, sizeof(buf));
+	name = strrchr(buf, '/');
+	process->name = strdup(size > 0 ? (name ? name + 1 : buf) : "");
+	for (i = 0; i < size - 1; i++)
+		if (buf[i] == '\0')
+			buf[i] = ' ';
+	process->cmdline = strdup(size > 0 ? buf : "");
+
+	size = proc_read(process->pid, "comm", buf, sizeof(buf));
+	if (size > 0 && buf[size - 1] == '\n')
+		buf[size - 1] = '\0';
+	process->comm = strdup(size > 0 ? buf : "");
+
+	snprintf(path, sizeof(path), "/proc/%d/exe", process->pid);
+	size = readlink(path, buf, sizeof(buf) - 1);
+	buf[size > 0 ? size : 0] = '\0';
+	process->exe = strdup(buf);
+}
+
+static void process_free(struct process *process)
+{
+	free(process->cmdline);
+	free(process->name);
+	free(process->exe);
+	free(process->comm);
+	process->cmdline = process->name = process->exe = process->comm = NULL;
+}
+
+static void process_remove(struct process *process)
+{
+	struct list *index;
+
+	for (index = processes_head; index != NULL; index = index->next) {
+		if (index->data != process)
+			continue;
+
+		event_remove_fd(process->pidfd);
+		close(process->pidfd);
+		process_free(process);
+		list_remove(&processes_head, index);
+		return;
+	}
+}
+
+static void process_exited(void *data)
+{
+	process_remove(data);
+}
+
+static bool process_alive(int pidfd)
+{
+	struct pollfd pfd = {pidfd, POLLIN, 0};
+
+	return poll(&pfd, 1, 0) == 0;
+}
+
+const struct process *process_get(pid_t pid)
+{
+	struct process *process;
+	struct list *index;
+	int pidfd;
+
+	for (index = processes_head; index != NULL; index = index->next) {
+		process = index->data;
+
+		if (process->pid == pid)
+			return process;
+	}
+
+	/* pinned before reading /proc, it can't be another process */
+	pidfd = syscall(SYS_pidfd_open, pid, 0);
+	if (pidfd == -1) {
+		if (errno != ESRCH)
+			LOGD("pidfd_open(%d): %s", pid, strerror(errno));
+
+		process_free(&process_unwatched);
+		process_unwatched.pid = pid;
+		process_unwatched.pidfd = -1;
+		process_read(&process_unwatched);
+		return &process_unwatched;
+	}
+	fcntl(pidfd, F_SETFD, FD_CLOEXEC);
+
+	process = calloc(1, sizeof(struct process));
+	if (process == NULL) {
+		close(pidfd);
+		return NULL;
+	}
+
+	process->pid = pid;
+	process->pidfd = pidfd;
+	process_read(process);
+
+	/* exited while we were reading, don't keep it */
+	if (process_alive(pidfd)
+	    && event_add_fd(pidfd, process_exited, process)) {
+		if (list_add(&processes_head, process) != NULL)
+			return process;
+		event_remove_fd(pidfd);
+	}
+
+	close(pidfd);
+	process_free(&process_unwatched);
+	process_unwatched = *process;
+	process_unwatched.pidfd = -1;
+	free(process);
+
+	return &process_unwatched;
+}
+
+void process_exit(void)
+{
+	while (processes_head != NULL)
+		process_remove(processes_head->data);
+
+	process_free(&process_unwatched);
+}
@@ -0,0 +1,39 @@
+/*
+ * This file is part of the jwm distribution:
+ * https://github.com/JulienMasson/jwm
+ *
+ * Copyright (c) 2017 Julien Masson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef PROCESS_H
+#define PROCESS_H
+
+#include <sys/types.h>
+
+struct process {
+	pid_t pid;
+	int pidfd;     /* readable once the process has exited */
+	char *cmdline; /* arguments separated by spaces */
+	char *name;    /* basename of the first argument */
+	char *exe;     /* resolved executable, may be empty */
+	char *comm;    /* kernel name, may be truncated */
+};
+
+/* read once, dropped when the process exits */
+const struct process *process_get(pid_t pid);
+
+void process_exit(void);
+
+#endif
@@ -0,0 +1,139 @@
+/*
+ * This file is part of the jwm distribution:
+ * https://github.com/JulienMasson/jwm
+ *
+ * Copyright (c) 2017 Julien Masson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <regex.h>
+#include <stdlib.h>
+
+#include "rules.h"
+#include "list.h"
+#include "log.h"
+
+/* Rules are compiled once when the conf is read, matching a new window
+ * only runs regexec on its properties. */
+
+struct rule {
+	regex_t regex[RULE_LAST];
+	bool set[RULE_LAST];
+	const struct conf_rule *conf;
+};
+
+static struct list *rules_head = NULL;
+
+static void rule_free(struct rule *rule)
+{
+	int i;
+
+	for (i = 0; i < RULE_LAST; i++)
+		if (rule->set[i])
+			regfree(&rule->regex[i]);
+}
+
+static struct rule *rule_compile(const struct conf_rule *conf)
+{
+	struct rule *rule;
+	char error_msg[256];
+	int i, ret;
+
+	rule = calloc(1, sizeof(struct rule));
+	if (rule == NULL)
+		return NULL;
+	rule->conf = conf;
+
+	for (i = 0; i < RULE_LAST; i++) {
+		if (conf->match[i] == NULL)
+			continue;
+
+		ret = regcomp(&rule->regex[i], conf->match[i],
+			      REG_EXTENDED | REG_NOSUB);
+		if (ret != 0) {
+			regerror(ret, &rule->regex[i], error_msg, 256);
+			LOGW("Rule \"%s\": %s", conf->match[i], error_msg);
+			rule_free(rule);
+			free(rule);
+			return NULL;
+		}
+		rule->set[i] = true;
+	}
+
+	return rule;
+}
+
+void rules_reload(void)
+{
+	struct list *index;
+	struct rule *rule;
+
+	rules_exit();
+
+	for (index = global_conf.rules; index != NULL; index = index->next) {
+		rule = rule_compile(index->data);
+		if (rule == NULL)
+			continue;
+
+		if (list_add(&rules_head, rule) == NULL) {
+			rule_free(rule);
+			free(rule);
+		}
+	}
+}
+
+bool rules_loaded(void)
+{
+	return rules_head != NULL;
+}
+
+static bool rule_match(struct rule *rule, const char *props[RULE_LAST])
+{
+	int i;
+
+	for (i = 0; i < RULE_LAST; i++) {
+		if (!rule->set[i])
+			continue;
+
+		/* a missing property never matches */
+		if (props[i] == NULL
+		    || regexec(&rule->regex[i], props[i], 0, NULL, 0) != 0)
+			return false;
+	}
+
+	return true;
+}
+
+const struct conf_rule *rules_match(const char *props[RULE_LAST])
+{
+	struct list *index;
+	struct rule *rule;
+
+	for (index = rules_head; index != NULL; index = index->next) {
+		rule = index->data;
+
+		if (rule_match(rule, props))
+			return rule->conf;
+	}
+
+	return NULL;
+}
+
+void rules_exit(void)
+{
+	while (rules_head != NULL) {
+		rule_free(rules_head->data);
+		list_remove(&rules_head, rules_head);
+	}
+}
@@ -0,0 +1,37 @@
+/*
+ * This file is part of the jwm distribution:
+ * https://github.com/JulienMasson/jwm
+ *
+ * Copyright (c) 2017 Julien Masson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RULES_H
+#define RULES_H
+
+#include <stdbool.h>
+
+#include "conf.h"
+
+/* compile the matchers of the conf rules */
+void rules_reload(void);
+
+bool rules_loaded(void);
+
+/* first rule matching the properties, NULL if none */
+const struct conf_rule *rules_match(const char *props[RULE_LAST]);
+
+void rules_exit(void);
+
+#endif
@@ -0,0 +1,217 @@
+/*
+ * This file is part of the jwm distribution:
+ * https://github.com/JulienMasson/jwm
+ *
+ * Copyright (c) 2018 Julien Masson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+
+#include "global.h"
+#include "shadow.h"
+#include "log.h"
+
+#define SHADOW_BUCKETS 64
+
+/* windows mirrored, hashed by ID */
+static struct list *shadows_head[SHADOW_BUCKETS];
+
+static struct list **shadow_bucket(xcb_window_t win)
+{
+	return &shadows_head[win % SHADOW_BUCKETS];
+}
+
+struct shadow *shadow_find(xcb_window_t win)
+{
+	struct shadow *shadow;
+	struct list *index;
+
+	for (index = *shadow_bucket(win); index != NULL; index = index->next) {
+		shadow = index->data;
+
+		if (win == shadow->id)
+			return shadow;
+	}
+
+	return NULL;
+}
+
+static struct shadow *shadow_add(xcb_window_t win, xcb_window_t parent)
+{
+	struct list *index;
+	struct shadow *shadow;
+
+	/* already known, reuse it */
+	shadow = shadow_find(win);
+	if (shadow != NULL)
+		return shadow;
+
+	shadow = malloc(sizeof(struct shadow));
+	if (shadow == NULL)
+		return NULL;
+
+	index = list_add(shadow_bucket(win), shadow);
+	if (index == NULL) {
+		free(shadow);
+		return NULL;
+	}
+
+	shadow->id = win;
+	shadow->parent = parent;
+	shadow->x = shadow->y = shadow->width = shadow->height =
+		shadow->border_width = 0;
+	shadow->mapped = false;
+	shadow->override_redirect = false;
+	shadow->index = index;
+
+	return shadow;
+}
+
+static void shadow_remove(xcb_window_t win)
+{
+	struct shadow *shadow = shadow_find(win);
+
+	if (shadow != NULL)
+		list_remove(shadow_bucket(win), shadow->index);
+}
+
+void shadow_init(void)
+{
+	xcb_query_tree_cookie_t tree_cookie;
+	xcb_query_tree_reply_t *tree;
+	xcb_window_t *children;
+	int i, len;
+
+	/* get windows existing before us */
+	tree_cookie = xcb_query_tree(conn, screen->root);
+	tree = xcb_query_tree_reply(conn, tree_cookie, NULL);
+	if (tree == NULL) {
+		LOGE("Query tree failed");
+		return;
+	}
+	children = xcb_query_tree_children(tree);
+	len = xcb_query_tree_children_length(tree);
+
+	/* send all requests first, then wait for the replies */
+	xcb_get_geometry_cookie_t geom_cookies[len];
+	xcb_get_window_attributes_cookie_t attr_cookies[len];
+	for (i = 0; i < len; i++) {
+		geom_cookies[i] = xcb_get_geometry(conn, children[i]);
+		attr_cookies[i] = xcb_get_window_attributes(conn, children[i]);
+	}
+
+	for (i = 0; i < len; i++) {
+		xcb_get_geometry_reply_t *geom;
+		xcb_get_window_attributes_reply_t *attr;
+		struct shadow *shadow;
+
+		geom = xcb_get_geometry_reply(conn, geom_cookies[i], NULL);
+		attr = xcb_get_window_attributes_reply(conn, attr_cookies[i],
+						       NULL);
+
+		shadow = shadow_add(children[i], screen->root);
+		if (shadow != NULL && geom != NULL) {
+			shadow->x = geom->x;
+			shadow->y = geom->y;
+			shadow->width = geom->width;
+			shadow->height = geom->height;
+			shadow->border_width = geom->border_width;
+		}
+		if (shadow != NULL && attr != NULL) {
+			shadow->mapped =
+				attr->map_state != XCB_MAP_STATE_UNMAPPED;
+			shadow->override_redirect = attr->override_redirect;
+		}
+
+		free(geom);
+		free(attr);
+	}
+
+	free(tree);
+}
+
+void shadow_create(xcb_create_notify_event_t *ev)
+{
+	struct shadow *shadow = shadow_add(ev->window, ev->parent);
+
+	if (shadow == NULL)
+		return;
+
+	shadow->parent = ev->parent;
+	shadow->x = ev->x;
+	shadow->y = ev->y;
+	shadow->width = ev->width;
+	shadow->height = ev->height;
+	shadow->border_width = ev->border_width;
+	shadow->override_redirect = ev->override_redirect;
+}
+
+void shadow_destroy(xcb_destroy_notify_event_t *ev)
+{
+	shadow_remove(ev->window);
+}
+
+void shadow_configure(xcb_configure_notify_event_t *ev)
+{
+	struct shadow *shadow = shadow_find(ev->window);
+
+	if (shadow == NULL)
+		return;
+
+	shadow->x = ev->x;
+	shadow->y = ev->y;
+	shadow->width = ev->width;
+	shadow->height = ev->height;
+	shadow->border_width = ev->border_width;
+	shadow->override_redirect = ev->override_redirect;
+}
+
+void shadow_map(xcb_map_notify_event_t *ev)
+{
+	struct shadow *shadow = shadow_find(ev->window);
+
+	if (shadow == NULL)
+		return;
+
+	shadow->mapped = true;
+	shadow->override_redirect = ev->override_redirect;
+}
+
+void shadow_unmap(xcb_unmap_notify_event_t *ev)
+{
+	struct shadow *shadow = shadow_find(ev->window);
+
+	if (shadow != NULL)
+		shadow->mapped = false;
+}
+
+void shadow_reparent(xcb_reparent_notify_event_t *ev)
+{
+	struct shadow *shadow = shadow_find(ev->window);
+
+	if (shadow == NULL)
+		return;
+
+	/* away from root its ConfigureNotify no longer reaches us */
+	if (ev->parent != screen->root) {
+		shadow_remove(ev->window);
+		return;
+	}
+
+	shadow->parent = ev->parent;
+	shadow->x = ev->x;
+	shadow->y = ev->y;
+	shadow->override_redirect = ev->override_redirect;
+}
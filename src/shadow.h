@@ -0,0 +1,54 @@
+/*
+ * This file is part of the jwm distribution:
+ * https://github.com/JulienMasson/jwm
+ *
+ * Copyright (c) 2018 Julien Masson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SHADOW_H
+#define SHADOW_H
+
+#include <stdbool.h>
+#include <xcb/xcb.h>
+
+#include "list.h"
+
+/* local mirror of a window, kept up to date from StructureNotify events */
+struct shadow {
+	xcb_window_t id;	// ID of this window.
+	xcb_window_t parent;    // ID of the parent window.
+	int16_t x, y;		// X/Y coordinate relative to the parent.
+	uint16_t width, height; // Width,Height in pixels.
+	uint16_t border_width;  // Border width in pixels.
+	bool mapped;		// Map state.
+	bool override_redirect; // Not managed by the WM.
+	struct list *index;     // Pointer to our place in the bucket list.
+};
+
+/* init */
+void shadow_init(void);
+
+/* accessors */
+struct shadow *shadow_find(xcb_window_t win);
+
+/* events handler */
+void shadow_create(xcb_create_notify_event_t *ev);
+void shadow_destroy(xcb_destroy_notify_event_t *ev);
+void shadow_configure(xcb_configure_notify_event_t *ev);
+void shadow_map(xcb_map_notify_event_t *ev);
+void shadow_unmap(xcb_unmap_notify_event_t *ev);
+void shadow_reparent(xcb_reparent_notify_event_t *ev);
+
+#endif
@@ -0,0 +1,333 @@
+/*
+ * This file is part of the jwm distribution:
+ * https://github.com/JulienMasson/jwm
+ *
+ * Copyright (c) 2017 Julien Masson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+
+#include "spawner.h"
+#include "event.h"
+#include "list.h"
+#include "log.h"
+#include "metrics.h"
+#include "pool.h"
+
+/* The launcher helper is forked before X, cairo and pango are set up, so
+ * spawning from it costs the same whatever the size of the WM. It gets
+ * argv as NUL separated strings and answers with spawn_reply messages. */
+
+#define SPAWN_MSG_MAX 4096
+#define SPAWN_ARGS_MAX 64
+
+enum { SPAWN_STARTED, SPAWN_EXITED };
+
+struct spawn_reply {
+	int type;
+	pid_t pid;
+	int status; /* errno when started, wait status when exited */
+};
+
+struct spawn_request {
+	struct timespec start;
+	spawner_func_t func;
+	void *data;
+};
+
+extern char **environ;
+
+static int spawn_sock = -1;
+static pid_t spawn_pid = -1;
+
+/* requests are answered in order */
+static struct list *spawn_pending = NULL;
+
+static void helper_reply(int sock, int type, pid_t pid, int status)
+{
+	struct spawn_reply reply = {type, pid, status};
+
+	send(sock, &reply, sizeof(reply), MSG_NOSIGNAL);
+}
+
+static void helper_spawn(int sock, char *buf, ssize_t len)
+{
+	char *argv[SPAWN_ARGS_MAX + 1];
+	posix_spawnattr_t attr;
+	sigset_t mask;
+	short flags;
+	pid_t pid = -1;
+	ssize_t pos = 0;
+	int argc = 0, ret;
+
+	while (pos < len && argc < SPAWN_ARGS_MAX) {
+		argv[argc++] = buf + pos;
+		pos += strlen(buf + pos) + 1;
+	}
+	argv[argc] = NULL;
+
+	if (argc == 0) {
+		helper_reply(sock, SPAWN_STARTED, -1, EINVAL);
+		return;
+	}
+
+	/* new session, default signal handling, nothing blocked */
+	posix_spawnattr_init(&attr);
+	flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+#ifdef POSIX_SPAWN_SETSID
+	flags |= POSIX_SPAWN_SETSID;
+#endif
+	posix_spawnattr_setflags(&attr, flags);
+	sigemptyset(&mask);
+	posix_spawnattr_setsigmask(&attr, &mask);
+	sigfillset(&mask);
+	posix_spawnattr_setsigdefault(&attr, &mask);
+
+	ret = posix_spawnp(&pid, argv[0], NULL, &attr, argv, environ);
+	posix_spawnattr_destroy(&attr);
+
+	helper_reply(sock, SPAWN_STARTED, ret == 0 ? pid : -1, ret);
+}
+
+static void helper_reap(int sock, int sfd)
+{
+	struct signalfd_siginfo info;
+	pid_t pid;
+	int status;
+
+	while (read(sfd, &info, sizeof(info)) == sizeof(info))
+		;
+
+	while ((pid = waitpid(-1, &status, WNOHANG)) > 0)
+		helper_reply(sock, SPAWN_EXITED, pid, status);
+}
+
+static void __attribute__((noreturn)) helper_loop(int sock)
+{
+	char buf[SPAWN_MSG_MAX];
+	struct pollfd fds[2];
+	sigset_t mask;
+	ssize_t len;
+	int sfd;
+
+	/* children exits come through a signalfd */
+	sigemptyset(&mask);
+	sigaddset(&mask, SIGCHLD);
+	sigprocmask(SIG_BLOCK, &mask, NULL);
+	sfd = signalfd(-1, &mask, SFD_NONBLOCK | SFD_CLOEXEC);
+
+	fds[0].fd = sock;
+	fds[0].events = POLLIN;
+	fds[1].fd = sfd;
+	fds[1].events = POLLIN;
+
+	for (;;) {
+		if (poll(fds, sfd == -1 ? 1 : 2, -1) == -1) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		if (sfd != -1 && (fds[1].revents & POLLIN))
+			helper_reap(sock, sfd);
+
+		if (fds[0].revents & (POLLIN | POLLHUP | POLLERR)) {
+			/* WM is gone */
+			len = recv(sock, buf, sizeof(buf) - 1, 0);
+			if (len <= 0)
+				break;
+
+			buf[len] = '\0';
+			helper_spawn(sock, buf, len);
+		}
+	}
+
+	_exit(EXIT_SUCCESS);
+}
+
+static long spawn_elapsed_us(struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1000000L
+	       + (now.tv_nsec - start->tv_nsec) / 1000L;
+}
+
+static void spawn_started(struct spawn_reply *reply)
+{
+	struct spawn_request *request;
+	long latency;
+
+	if (spawn_pending == NULL)
+		return;
+
+	request = spawn_pending->data;
+	latency = spawn_elapsed_us(&request->start);
+
+	if (reply->pid == -1) {
+		LOGE("Spawn failed: %s", strerror(reply->status));
+	} else {
+		metrics_inc(METRIC_SPAWN);
+		metrics_add(METRIC_SPAWN_LATENCY_US, latency);
+		LOGD("Spawned pid %d in %ld us", reply->pid, latency);
+	}
+
+	if (request->func != NULL)
+		request->func(reply->pid, request->data);
+
+	list_remove(&spawn_pending, spawn_pending);
+}
+
+static void spawn_event(void __attribute__((__unused__)) * data)
+{
+	struct spawn_reply reply;
+	ssize_t len;
+
+	while ((len = recv(spawn_sock, &reply, sizeof(reply), MSG_DONTWAIT))
+	       == sizeof(reply)) {
+		if (reply.type == SPAWN_STARTED)
+			spawn_started(&reply);
+		else
+			spawner_child_exited(reply.pid, reply.status);
+	}
+
+	/* helper died, start() falls back on fork */
+	if (len == 0) {
+		LOGE("Launcher helper exited");
+		spawner_exit();
+	}
+}
+
+bool spawner_init(void)
+{
+	int sv[2];
+
+	if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sv) == -1) {
+		LOGE("Failed to create launcher socket");
+		return false;
+	}
+
+	spawn_pid = fork();
+	if (spawn_pid == -1) {
+		LOGE("Failed to fork launcher helper");
+		close(sv[0]);
+		close(sv[1]);
+		return false;
+	}
+
+	if (spawn_pid == 0) {
+		close(sv[0]);
+		helper_loop(sv[1]);
+	}
+
+	close(sv[1]);
+	spawn_sock = sv[0];
+
+	return event_add_fd(spawn_sock, spawn_event, NULL);
+}
+
+bool spawner_run(const char **argv, spawner_func_t func, void *data)
+{
+	struct spawn_request *request;
+	struct list *index;
+	char buf[SPAWN_MSG_MAX];
+	size_t len = 0, arg_len;
+	int i;
+
+	if (spawn_sock == -1 || argv == NULL || argv[0] == NULL)
+		return false;
+
+	/* serialize argv */
+	for (i = 0; argv[i] != NULL && i < SPAWN_ARGS_MAX; i++) {
+		arg_len = strlen(argv[i]) + 1;
+		if (len + arg_len > sizeof(buf)) {
+			LOGE("Command line too long for launcher");
+			return false;
+		}
+		memcpy(buf + len, argv[i], arg_len);
+		len += arg_len;
+	}
+
+	request = malloc(sizeof(struct spawn_request));
+	if (request == NULL)
+		return false;
+
+	clock_gettime(CLOCK_MONOTONIC, &request->start);
+	request->func = func;
+	request->data = data;
+
+	index = list_add(&spawn_pending, request);
+	if (index == NULL) {
+		free(request);
+		return false;
+	}
+
+	if (send(spawn_sock, buf, len, MSG_NOSIGNAL) != (ssize_t)len) {
+		LOGE("Failed to send to launcher helper");
+		list_remove(&spawn_pending, index);
+		return false;
+	}
+
+	return true;
+}
+
+void spawner_child_exited(pid_t pid, int status)
+{
+	metrics_inc(METRIC_CHILD_EXITED);
+	pool_child_exited(pid);
+
+	if (WIFEXITED(status) && WEXITSTATUS(status) == 0)
+		return;
+
+	metrics_inc(METRIC_CHILD_FAILED);
+	if (WIFEXITED(status))
+		LOGW("Child %d exited with status %d", pid,
+		     WEXITSTATUS(status));
+	else if (WIFSIGNALED(status))
+		LOGW("Child %d killed by signal %d", pid, WTERMSIG(status));
+}
+
+void spawner_exit(void)
+{
+	struct spawn_request *request;
+
+	if (spawn_sock == -1)
+		return;
+
+	/* closing the socket stops the helper */
+	event_remove_fd(spawn_sock);
+	close(spawn_sock);
+	spawn_sock = -1;
+
+	/* nobody will answer, fail the requests still waiting */
+	while (spawn_pending != NULL) {
+		request = spawn_pending->data;
+
+		if (request->func != NULL)
+			request->func(-1, request->data);
+
+		list_remove(&spawn_pending, spawn_pending);
+	}
+}
@@ -0,0 +1,36 @@
+/*
+ * This file is part of the jwm distribution:
+ * https://github.com/JulienMasson/jwm
+ *
+ * Copyright (c) 2017 Julien Masson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef SPAWNER_H
+#define SPAWNER_H
+
+#include <stdbool.h>
+#include <sys/types.h>
+
+/* called with the pid of the new process, or -1 if it failed */
+typedef void (*spawner_func_t)(pid_t pid, void *data);
+
+bool spawner_init(void);
+
+bool spawner_run(const char **argv, spawner_func_t func, void *data);
+
+void spawner_child_exited(pid_t pid, int status);
+
+void spawner_exit(void);
+
+#endif
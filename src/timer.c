@@ -0,0 +1,331 @@
+/*
+ * This file is part of the jwm distribution:
+ * https://github.com/JulienMasson/jwm
+ *
+ * Copyright (c) 2017 Julien Masson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+#include "timer.h"
+#include "log.h"
+
+/* 4 levels of 64 slots: level 0 holds the next 64 ticks, each level
+ * above covers 64 times more, timers cascade down as time passes */
+#define WHEEL_BITS 6
+#define WHEEL_SIZE (1 << WHEEL_BITS)
+#define WHEEL_MASK (WHEEL_SIZE - 1)
+#define WHEEL_LEVELS 4
+#define WHEEL_RANGE (1ULL << (WHEEL_BITS * WHEEL_LEVELS))
+
+/* long timers are rounded up so they share wakeups */
+#define TIMER_SLACK_MIN WHEEL_SIZE
+#define TIMER_SLACK 16
+
+#define TIMER_NONE UINT64_MAX
+
+struct wheel {
+	struct timer *slots[WHEEL_LEVELS][WHEEL_SIZE];
+	uint64_t occupied[WHEEL_LEVELS];
+	uint64_t clk;   /* next tick to process */
+	uint64_t armed; /* tick programmed in the timerfd */
+	struct timespec base;
+	int fd;
+};
+
+static struct wheel wheel;
+
+static uint64_t timer_now(void)
+{
+	struct timespec now;
+	uint64_t ms;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	ms = (now.tv_sec - wheel.base.tv_sec) * 1000ULL
+	     + (now.tv_nsec - wheel.base.tv_nsec) / 1000000LL;
+
+	return ms / TIMER_TICK_MS;
+}
+
+static void timer_link(struct timer *timer)
+{
+	uint64_t expires = timer->expires;
+	uint64_t delta;
+	int level, slot;
+
+	/* already late, fire on the next processed tick */
+	if (expires < wheel.clk)
+		expires = wheel.clk;
+
+	delta = expires - wheel.clk;
+	if (delta >= WHEEL_RANGE) {
+		/* park it at the farthest slot, it cascades back later */
+		delta = WHEEL_RANGE - 1;
+		expires = wheel.clk + delta;
+	}
+
+	for (level = 0; level < WHEEL_LEVELS - 1; level++)
+		if (delta < (1ULL << (WHEEL_BITS * (level + 1))))
+			break;
+
+	slot = (expires >> (WHEEL_BITS * level)) & WHEEL_MASK;
+
+	timer->slot = &wheel.slots[level][slot];
+	timer->prev = NULL;
+	timer->next = *timer->slot;
+	if (timer->next != NULL)
+		timer->next->prev = timer;
+	*timer->slot = timer;
+	wheel.occupied[level] |= 1ULL << slot;
+}
+
+static void timer_unlink(struct timer *timer)
+{
+	ptrdiff_t pos;
+	int level, slot;
+
+	if (timer->prev != NULL)
+		timer->prev->next = timer->next;
+	else
+		*timer->slot = timer->next;
+	if (timer->next != NULL)
+		timer->next->prev = timer->prev;
+
+	/* last one out clears the slot bit */
+	if (*timer->slot == NULL) {
+		pos = timer->slot - &wheel.slots[0][0];
+		level = pos / WHEEL_SIZE;
+		slot = pos % WHEEL_SIZE;
+		wheel.occupied[level] &= ~(1ULL << slot);
+	}
+
+	timer->prev = timer->next = NULL;
+	timer->slot = NULL;
+}
+
+/* first tick needing work: an expiry on level 0, a cascade above */
+static uint64_t timer_next(void)
+{
+	uint64_t next = TIMER_NONE, tick, mask, block;
+	int level, index, dist;
+
+	for (level = 0; level < WHEEL_LEVELS; level++) {
+		if (wheel.occupied[level] == 0)
+			continue;
+
+		block = wheel.clk >> (WHEEL_BITS * level);
+		index = block & WHEEL_MASK;
+
+		/* rotate so the current index is bit 0 */
+		mask = wheel.occupied[level] >> index;
+		if (index != 0)
+			mask |= wheel.occupied[level] << (WHEEL_SIZE - index);
+		dist = __builtin_ctzll(mask);
+
+		if (level == 0) {
+			tick = wheel.clk + dist;
+		} else {
+			/* current index only cascades now if we sit at the
+			 * start of its block, otherwise on the next lap */
+			if (dist == 0
+			    && (wheel.clk
+				& ((1ULL << (WHEEL_BITS * level)) - 1)))
+				dist = WHEEL_SIZE;
+			tick = (block + dist) << (WHEEL_BITS * level);
+		}
+
+		if (tick < next)
+			next = tick;
+	}
+
+	return next;
+}
+
+static void timer_program(void)
+{
+	struct itimerspec its;
+	uint64_t next = timer_next();
+	uint64_t ms;
+
+	/* earliest deadline unchanged, leave the timerfd alone */
+	if (next == wheel.armed)
+		return;
+
+	memset(&its, 0, sizeof(its));
+	if (next != TIMER_NONE) {
+		ms = next * TIMER_TICK_MS;
+		its.it_value.tv_sec = wheel.base.tv_sec + ms / 1000;
+		its.it_value.tv_nsec = wheel.base.tv_nsec;
+		its.it_value.tv_nsec += (ms % 1000) * 1000000;
+		if (its.it_value.tv_nsec >= 1000000000L) {
+			its.it_value.tv_sec++;
+			its.it_value.tv_nsec -= 1000000000L;
+		}
+
+		/* a zero value would disarm the timer */
+		if (its.it_value.tv_sec == 0 && its.it_value.tv_nsec == 0)
+			its.it_value.tv_nsec = 1;
+	}
+
+	if (timerfd_settime(wheel.fd, TFD_TIMER_ABSTIME, &its, NULL) == -1)
+		LOGE("Failed to program timer");
+	wheel.armed = next;
+}
+
+static void timer_cascade(int level)
+{
+	int slot = (wheel.clk >> (WHEEL_BITS * level)) & WHEEL_MASK;
+	struct timer *timer;
+
+	while ((timer = wheel.slots[level][slot]) != NULL) {
+		timer_unlink(timer);
+		timer_link(timer);
+	}
+}
+
+static void timer_tick(uint64_t now)
+{
+	struct timer *timer;
+	int level, slot;
+
+	/* move down the timers whose block starts now */
+	for (level = 1; level < WHEEL_LEVELS; level++) {
+		if (wheel.clk & ((1ULL << (WHEEL_BITS * level)) - 1))
+			break;
+		timer_cascade(level);
+	}
+
+	slot = wheel.clk & WHEEL_MASK;
+	while ((timer = wheel.slots[0][slot]) != NULL) {
+		timer_unlink(timer);
+
+		/* periodic timers don't try to catch up missed periods */
+		if (timer->interval != 0) {
+			timer->expires += timer->interval;
+			if (timer->expires <= now)
+				timer->expires = now + timer->interval;
+			timer_link(timer);
+		}
+
+		timer->func(timer->data);
+	}
+}
+
+bool timer_init(void)
+{
+	memset(&wheel, 0, sizeof(wheel));
+	wheel.armed = TIMER_NONE;
+
+	clock_gettime(CLOCK_MONOTONIC, &wheel.base);
+	wheel.fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (wheel.fd == -1) {
+		LOGE("Failed to create timer");
+		return false;
+	}
+
+	return true;
+}
+
+int timer_get_fd(void)
+{
+	return wheel.fd;
+}
+
+void timer_setup(struct timer *timer, timer_func_t func, void *data)
+{
+	memset(timer, 0, sizeof(struct timer));
+	timer->func = func;
+	timer->data = data;
+}
+
+void timer_add(struct timer *timer, uint32_t delay_ms, uint32_t interval_ms)
+{
+	uint64_t delay = (delay_ms + TIMER_TICK_MS - 1) / TIMER_TICK_MS;
+	uint64_t now = timer_now();
+
+	if (timer_pending(timer))
+		timer_unlink(timer);
+
+	/* nothing due until now, catch the wheel up before linking */
+	if (wheel.clk < now && timer_next() > now)
+		wheel.clk = now;
+
+	/* never on the tick being processed, a callback re-adding
+	 * itself would loop forever */
+	if (delay == 0)
+		delay = 1;
+
+	/* coalesce long timers on a coarser grid */
+	timer->expires = now + delay;
+	if (delay >= TIMER_SLACK_MIN)
+		timer->expires = (timer->expires + TIMER_SLACK - 1)
+				 & ~(uint64_t)(TIMER_SLACK - 1);
+	timer->interval = (interval_ms + TIMER_TICK_MS - 1) / TIMER_TICK_MS;
+
+	timer_link(timer);
+
+	if (timer->expires < wheel.armed)
+		timer_program();
+}
+
+void timer_cancel(struct timer *timer)
+{
+	/* the timerfd is not touched, at worst it wakes us once for
+	 * nothing and gets reprogrammed then */
+	if (timer_pending(timer))
+		timer_unlink(timer);
+}
+
+bool timer_pending(struct timer *timer)
+{
+	return timer->slot != NULL;
+}
+
+void timer_run(void)
+{
+	uint64_t expirations, now, next;
+
+	/* acknowledge the timerfd */
+	if (read(wheel.fd, &expirations, sizeof(expirations)) == -1)
+		expirations = 0;
+	wheel.armed = TIMER_NONE;
+
+	now = timer_now();
+	while (wheel.clk <= now) {
+		/* skip over ticks with nothing to do */
+		next = timer_next();
+		if (next > now)
+			break;
+		if (next > wheel.clk)
+			wheel.clk = next;
+
+		timer_tick(now);
+		wheel.clk++;
+	}
+	if (wheel.clk <= now)
+		wheel.clk = now + 1;
+
+	timer_program();
+}
+
+void timer_exit(void)
+{
+	if (wheel.fd != -1)
+		close(wheel.fd);
+	wheel.fd = -1;
+}
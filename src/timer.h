@@ -0,0 +1,57 @@
+/*
+ * This file is part of the jwm distribution:
+ * https://github.com/JulienMasson/jwm
+ *
+ * Copyright (c) 2017 Julien Masson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef TIMER_H
+#define TIMER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* resolution of the wheel, expiries within a tick fire together */
+#define TIMER_TICK_MS 4
+
+typedef void (*timer_func_t)(void *data);
+
+/* storage is owned by the caller, the wheel only links it */
+struct timer {
+	uint64_t expires;  /* tick */
+	uint32_t interval; /* ticks, 0 for one-shot */
+	timer_func_t func;
+	void *data;
+	struct timer *prev;
+	struct timer *next;
+	struct timer **slot;
+};
+
+bool timer_init(void);
+
+int timer_get_fd(void);
+
+void timer_setup(struct timer *timer, timer_func_t func, void *data);
+
+void timer_add(struct timer *timer, uint32_t delay_ms, uint32_t interval_ms);
+
+void timer_cancel(struct timer *timer);
+
+bool timer_pending(struct timer *timer);
+
+void timer_run(void);
+
+void timer_exit(void);
+
+#endif
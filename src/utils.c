@@ -28,6 +28,7 @@
 #include <dirent.h>
 #include <stdlib.h>
 #include <limits.h>
+#include <pthread.h>
 
 #include "utils.h"
 #include "log.h"
@@ -129,93 +130,249 @@ char **file_in_dir(const char *path, int *count)
 	return files;
 }
 
-bool regex_match(const char *string, const char *regex)
-{
+/* compiled patterns, the least recently used one is replaced */
+#define REGEX_CACHE_SIZE 16
+
+struct regex_entry {
+	char *pattern;
+	int cflags;
 	regex_t preg;
-	int ret;
+	unsigned long used;
+};
+
+static struct regex_entry regex_cache[REGEX_CACHE_SIZE];
+static unsigned long regex_clock = 0;
+
+/* used by the widgets from their thread, which is canceled and not
+ * joined: the old and new thread may overlap on a reload, and the cache
+ * is cleared from the main thread. Held until regexec is done since an
+ * eviction frees the compiled pattern */
+static pthread_mutex_t regex_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static void regex_lock(int *cancel_state)
+{
+	/* the widgets thread is canceled, never with the lock held */
+	pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, cancel_state);
+	pthread_mutex_lock(&regex_mutex);
+}
+
+static void regex_unlock(int cancel_state)
+{
+	pthread_mutex_unlock(&regex_mutex);
+	pthread_setcancelstate(cancel_state, NULL);
+}
+
+static regex_t *regex_get(const char *regex, int cflags)
+{
+	struct regex_entry *entry, *lru = &regex_cache[0];
 	char error_msg[256];
-	memset(error_msg, '\0', 256);
+	int i, ret;
+
+	for (i = 0; i < REGEX_CACHE_SIZE; i++) {
+		entry = &regex_cache[i];
+
+		if (entry->pattern != NULL && entry->cflags == cflags
+		    && strcmp(entry->pattern, regex) == 0) {
+			entry->used = ++regex_clock;
+			return &entry->preg;
+		}
+
+		if (entry->used < lru->used)
+			lru = entry;
+	}
+
+	/* evict the least recently used pattern */
+	if (lru->pattern != NULL) {
+		regfree(&lru->preg);
+		free(lru->pattern);
+		lru->pattern = NULL;
+		lru->used = 0;
+	}
 
-	/* compile regular expression */
-	ret = regcomp(&preg, regex, REG_NOSUB | REG_EXTENDED);
+	ret = regcomp(&lru->preg, regex, cflags);
 	if (ret != 0) {
-		regerror(ret, &preg, error_msg, 256);
+		regerror(ret, &lru->preg, error_msg, 256);
 		LOGE("%s\n", error_msg);
-		return false;
+		return NULL;
+	}
+
+	lru->pattern = strdup(regex);
+	if (lru->pattern == NULL) {
+		regfree(&lru->preg);
+		return NULL;
 	}
+	lru->cflags = cflags;
+	lru->used = ++regex_clock;
 
-	/* execute regular expression */
-	ret = regexec(&preg, string, 0, NULL, 0);
-	regfree(&preg);
+	return &lru->preg;
+}
 
-	/* check the return value */
+static bool regex_exec(regex_t *preg, const char *string, size_t nmatch,
+		       regmatch_t pmatch[])
+{
+	char error_msg[256];
+	int ret;
+
+	ret = regexec(preg, string, nmatch, pmatch, 0);
 	if (ret == 0)
 		return true;
-	else if (ret == REG_NOMATCH)
-		return false;
-	else {
-		regerror(ret, &preg, error_msg, 256);
+	else if (ret != REG_NOMATCH) {
+		regerror(ret, preg, error_msg, 256);
 		LOGE("%s\n", error_msg);
-		return false;
 	}
+
+	return false;
+}
+
+bool regex_match(const char *string, const char *regex)
+{
+	regex_t *preg;
+	bool ret = false;
+	int state;
+
+	regex_lock(&state);
+	preg = regex_get(regex, REG_NOSUB | REG_EXTENDED);
+	if (preg != NULL)
+		ret = regex_exec(preg, string, 0, NULL);
+	regex_unlock(state);
+
+	return ret;
+}
+
+bool regex_search(const char *string, const char *regex, size_t nmatch,
+		  regmatch_t pmatch[])
+{
+	regmatch_t matches[nmatch + 1];
+	regex_t *preg;
+	bool ret = false;
+	size_t i;
+	int state;
+
+	regex_lock(&state);
+	preg = regex_get(regex, REG_EXTENDED);
+	if (preg != NULL)
+		ret = regex_exec(preg, string, nmatch + 1, matches);
+	regex_unlock(state);
+
+	if (ret == false)
+		return false;
+
+	/* sub-expressions only, the whole match is dropped */
+	for (i = 0; i < nmatch; i++)
+		pmatch[i] = matches[i + 1];
+
+	return true;
 }
 
 bool regex_extract(const char *string, const char *regex, size_t nmatch,
 		   char pmatch[][256])
 {
-	regex_t preg;
-	uint8_t ret, i;
-	char error_msg[256];
-	regmatch_t matches[nmatch + 1];
+	regmatch_t matches[nmatch];
 	regoff_t so, eo;
-	memset(error_msg, '\0', 256);
+	size_t i;
 
-	/* compile regular expression */
-	ret = regcomp(&preg, regex, REG_EXTENDED);
-	if (ret != 0) {
-		regerror(ret, &preg, error_msg, 256);
-		LOGE("%s\n", error_msg);
+	if (!regex_search(string, regex, nmatch, matches))
 		return false;
+
+	for (i = 0; i < nmatch; i++) {
+		so = matches[i].rm_so;
+		eo = matches[i].rm_eo;
+		if (so == -1 || eo == -1)
+			continue;
+
+		/* truncated, the buffer is always terminated */
+		if (eo - so > 255)
+			eo = so + 255;
+		memcpy(pmatch[i], string + so, eo - so);
+		pmatch[i][eo - so] = '\0';
 	}
 
-	/* execute regular expression */
-	ret = regexec(&preg, string, nmatch + 1, matches, 0);
-	regfree(&preg);
-
-	/* check the return value */
-	if (ret == 0) {
-		for (i = 0; i < nmatch; i++) {
-			so = matches[i + 1].rm_so;
-			eo = matches[i + 1].rm_eo;
-			if (so != -1 && eo != -1)
-				memcpy(pmatch[i], string + so, eo - so);
-		}
-		return true;
-	} else if (ret == REG_NOMATCH)
+	return true;
+}
+
+void regex_cache_clear(void)
+{
+	int i, state;
+
+	regex_lock(&state);
+	for (i = 0; i < REGEX_CACHE_SIZE; i++) {
+		if (regex_cache[i].pattern == NULL)
+			continue;
+
+		regfree(&regex_cache[i].preg);
+		free(regex_cache[i].pattern);
+		regex_cache[i].pattern = NULL;
+		regex_cache[i].used = 0;
+	}
+	regex_unlock(state);
+}
+
+/* path of a file in our cache dir, the dir is created if needed */
+bool cache_path(char *path, size_t len, const char *name)
+{
+	const char *cache = getenv("XDG_CACHE_HOME");
+	char dir[PATH_MAX];
+
+	if (cache != NULL && cache[0] != '\0')
+		snprintf(dir, sizeof(dir), "%s", cache);
+	else if (getenv("HOME") != NULL)
+		snprintf(dir, sizeof(dir), "%s/.cache", getenv("HOME"));
+	else
 		return false;
-	else {
-		regerror(ret, &preg, error_msg, 256);
-		LOGE("%s\n", error_msg);
+
+	if (mkdir(dir, 0755) == -1 && errno != EEXIST)
 		return false;
+
+	strncat(dir, "/jwm", sizeof(dir) - strlen(dir) - 1);
+	if (mkdir(dir, 0755) == -1 && errno != EEXIST)
+		return false;
+
+	return snprintf(path, len, "%s/%s", dir, name) < (int)len;
+}
+
+/* split a command line in a NULL terminated argv */
+const char **command_parse(const char *line)
+{
+	char copy[strlen(line) + 1];
+	char *token, *saveptr = NULL;
+	char **argv = NULL;
+	int argc = 0;
+
+	snprintf(copy, sizeof(copy), "%s", line);
+	for (token = strtok_r(copy, " \t", &saveptr); token != NULL;
+	     token = strtok_r(NULL, " \t", &saveptr)) {
+		argv = realloc(argv, (argc + 2) * sizeof(char *));
+		argv[argc++] = strdup(token);
 	}
+
+	if (argv != NULL)
+		argv[argc] = NULL;
+
+	return (const char **)argv;
 }
 
-void get_process_name(uint32_t pid, char *name, size_t len)
+void command_free(const char **argv)
 {
-	FILE *fp;
-	char proc_path[BUFSIZ];
-	size_t size;
+	int i;
 
-	snprintf(proc_path, BUFSIZ, "/proc/%d/cmdline", pid);
-	fp = fopen(proc_path, "r");
-	if (fp == NULL) {
-		LOGE("%s", strerror(errno));
+	if (argv == NULL)
 		return;
-	}
 
-	size = fread(name, sizeof(char), len, fp);
-	if ((size > 0) && (name[size - 1] == '\n'))
-		name[size - 1] = '\0';
+	for (i = 0; argv[i] != NULL; i++)
+		free((char *)argv[i]);
+	free(argv);
+}
+
+bool command_equal(const char **a, const char **b)
+{
+	int i;
+
+	if (a == NULL || b == NULL)
+		return a == b;
+
+	for (i = 0; a[i] != NULL && b[i] != NULL; i++)
+		if (strcmp(a[i], b[i]) != 0)
+			return false;
 
-	fclose(fp);
+	return a[i] == NULL && b[i] == NULL;
 }
@@ -22,6 +22,8 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <sys/types.h>
+#include <regex.h>
 
 #define LENGTH(x) (sizeof(x) / sizeof(*x))
 
@@ -33,13 +35,19 @@ bool file_access(const char *pathname);
 bool file_write(const char *pathname, const void *buf, size_t count);
 bool file_read(const char *pathname, void *buf, size_t count);
 char **file_in_dir(const char *path, int *count);
+bool cache_path(char *path, size_t len, const char *name);
 
-/* pattern matching */
+/* pattern matching, compiled patterns are cached */
 bool regex_match(const char *string, const char *regex);
+bool regex_search(const char *string, const char *regex, size_t nmatch,
+		  regmatch_t pmatch[]);
 bool regex_extract(const char *string, const char *regex, size_t nmatch,
 		   char pmatch[][256]);
+void regex_cache_clear(void);
 
-/* system utils */
-void get_process_name(uint32_t pid, char *name, size_t len);
+/* command line utils */
+const char **command_parse(const char *line);
+void command_free(const char **argv);
+bool command_equal(const char **a, const char **b);
 
 #endif
@@ -17,11 +17,60 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdio.h>
+#include <string.h>
 #include <xcb/xcb_icccm.h>
 
 #include "global.h"
 #include "window.h"
 #include "atom.h"
+#include "shadow.h"
+#include "cursor.h"
+#include "utils.h"
+
+/* sequences of our own restacks and warps, see window_ignore_enter() */
+#define IGNORE_SEQ_MAX 16
+
+struct ignore_seq {
+	uint16_t sequence;
+	bool valid;
+};
+
+static struct ignore_seq ignore_seqs[IGNORE_SEQ_MAX];
+static int ignore_seq_next = 0;
+
+static void ignore_enter_from(xcb_void_cookie_t cookie)
+{
+	ignore_seqs[ignore_seq_next].sequence = cookie.sequence & 0xFFFF;
+	ignore_seqs[ignore_seq_next].valid = true;
+	ignore_seq_next = (ignore_seq_next + 1) % IGNORE_SEQ_MAX;
+
+	/* events carry the last request processed, without a request after
+	 * it the crossings made by the user would share this sequence */
+	xcb_no_operation(conn);
+}
+
+bool window_ignore_enter(xcb_enter_notify_event_t *ev)
+{
+	bool ignore = false;
+	int16_t delta;
+	int i;
+
+	for (i = 0; i < IGNORE_SEQ_MAX; i++) {
+		if (ignore_seqs[i].valid == false)
+			continue;
+
+		/* a single request can produce several crossings, keep the
+		 * entry until the server has moved past it */
+		delta = (int16_t)(ev->sequence - ignore_seqs[i].sequence);
+		if (delta == 0)
+			ignore = true;
+		else if (delta > 0)
+			ignore_seqs[i].valid = false;
+	}
+
+	return ignore;
+}
 
 xcb_window_t window_create(uint16_t x, uint16_t y, uint16_t width,
 			   uint16_t height)
@@ -65,22 +114,27 @@ void window_raise(xcb_window_t win)
 	if (win == screen->root)
 		return;
 
-	xcb_configure_window(conn, win, XCB_CONFIG_WINDOW_STACK_MODE, values);
+	ignore_enter_from(xcb_configure_window(
+		conn, win, XCB_CONFIG_WINDOW_STACK_MODE, values));
 	xcb_flush(conn);
 }
 
-void window_center_pointer(xcb_window_t win, int16_t width, int16_t height)
+void window_center_pointer(int16_t x, int16_t y, uint16_t width,
+			   uint16_t height)
 {
 	int16_t cur_x, cur_y;
 
-	cur_x = width / 2;
-	cur_y = height / 2;
+	cur_x = x + width / 2;
+	cur_y = y + height / 2;
 
-	xcb_warp_pointer(conn, XCB_NONE, win, 0, 0, 0, 0, cur_x, cur_y);
+	/* warp relative to root, so we know where the pointer lands */
+	ignore_enter_from(xcb_warp_pointer(conn, XCB_NONE, screen->root, 0, 0,
+					   0, 0, cur_x, cur_y));
+	cursor_track_coordinates(cur_x, cur_y);
 	xcb_flush(conn);
 }
 
-void window_set_focus(xcb_window_t win)
+void window_set_normal_state(xcb_window_t win)
 {
 	long data[] = {XCB_ICCCM_WM_STATE_NORMAL, XCB_NONE};
 
@@ -90,6 +144,13 @@ void window_set_focus(xcb_window_t win)
 	xcb_change_property(conn, XCB_PROP_MODE_REPLACE, win,
 			    ewmh->_NET_WM_STATE, ewmh->_NET_WM_STATE, 32, 2,
 			    data);
+}
+
+void window_set_focus(xcb_window_t win)
+{
+	if (win == screen->root)
+		return;
+
 	xcb_set_input_focus(conn, XCB_INPUT_FOCUS_POINTER_ROOT, win,
 			    XCB_CURRENT_TIME);
 	xcb_change_property(conn, XCB_PROP_MODE_REPLACE, screen->root,
@@ -143,10 +204,22 @@ void window_move_resize(xcb_window_t win, const uint16_t x, const uint16_t y,
 bool window_get_geom(xcb_window_t win, int16_t *x, int16_t *y, uint16_t *width,
 		     uint16_t *height)
 {
-	xcb_get_geometry_cookie_t cookie = xcb_get_geometry(conn, win);
-	xcb_get_geometry_reply_t *geom =
-		xcb_get_geometry_reply(conn, cookie, NULL);
+	xcb_get_geometry_cookie_t cookie;
+	xcb_get_geometry_reply_t *geom;
+	struct shadow *shadow;
+
+	/* use the local mirror, avoid a round trip */
+	shadow = shadow_find(win);
+	if (shadow != NULL) {
+		*x = shadow->x;
+		*y = shadow->y;
+		*width = shadow->width;
+		*height = shadow->height;
+		return true;
+	}
 
+	cookie = xcb_get_geometry(conn, win);
+	geom = xcb_get_geometry_reply(conn, cookie, NULL);
 	if (geom == NULL)
 		return false;
 
@@ -189,7 +262,8 @@ bool window_check_type(xcb_window_t win)
 void window_setup(xcb_window_t win)
 {
 	uint32_t values[2];
-	values[0] = XCB_EVENT_MASK_ENTER_WINDOW;
+	values[0] = XCB_EVENT_MASK_ENTER_WINDOW
+		    | XCB_EVENT_MASK_PROPERTY_CHANGE;
 	xcb_change_window_attributes_checked(conn, win, XCB_CW_EVENT_MASK,
 					     values);
 
@@ -231,20 +305,69 @@ bool window_hint_us_position(xcb_window_t win)
 	return false;
 }
 
-bool window_get_pointer(const xcb_window_t *win, int16_t *x, int16_t *y)
+void window_get_name(xcb_window_t win, char *name, uint32_t len)
 {
-	xcb_query_pointer_cookie_t cookie = xcb_query_pointer(conn, *win);
-	xcb_query_pointer_reply_t *pointer =
-		xcb_query_pointer_reply(conn, cookie, 0);
+	xcb_get_property_cookie_t cookie;
+	xcb_ewmh_get_utf8_strings_reply_t data;
 
-	if (pointer == NULL)
-		return false;
+	cookie = xcb_ewmh_get_wm_name(ewmh, win);
+	if (xcb_ewmh_get_wm_name_reply(ewmh, cookie, &data, NULL)) {
+		if (data.strings_len < len)
+			strncpy(name, data.strings, data.strings_len);
+		xcb_ewmh_get_utf8_strings_reply_wipe(&data);
+	}
+}
 
-	*x = pointer->win_x;
-	*y = pointer->win_y;
-	free(pointer);
+void window_get_class(xcb_window_t win, char *class, char *instance,
+		      uint32_t len)
+{
+	xcb_get_property_cookie_t cookie;
+	xcb_icccm_get_wm_class_reply_t data;
 
-	return true;
+	cookie = xcb_icccm_get_wm_class(conn, win);
+	if (xcb_icccm_get_wm_class_reply(conn, cookie, &data, NULL)) {
+		snprintf(class, len, "%s", data.class_name);
+		snprintf(instance, len, "%s", data.instance_name);
+		xcb_icccm_get_wm_class_reply_wipe(&data);
+	}
+}
+
+const char *window_get_type(xcb_window_t win)
+{
+	xcb_get_property_cookie_t cookie;
+	xcb_ewmh_get_atoms_reply_t win_type;
+	const char *name = "normal";
+	unsigned int i, j;
+	struct {
+		xcb_atom_t atom;
+		const char *name;
+	} types[] = {
+		{ewmh->_NET_WM_WINDOW_TYPE_NORMAL, "normal"},
+		{ewmh->_NET_WM_WINDOW_TYPE_DIALOG, "dialog"},
+		{ewmh->_NET_WM_WINDOW_TYPE_UTILITY, "utility"},
+		{ewmh->_NET_WM_WINDOW_TYPE_SPLASH, "splash"},
+		{ewmh->_NET_WM_WINDOW_TYPE_MENU, "menu"},
+		{ewmh->_NET_WM_WINDOW_TYPE_NOTIFICATION, "notification"},
+	};
+
+	cookie = xcb_ewmh_get_wm_window_type(ewmh, win);
+	if (xcb_ewmh_get_wm_window_type_reply(ewmh, cookie, &win_type, NULL)
+	    == 0)
+		return name;
+
+	/* first type we know, they are listed by preference */
+	for (i = 0; i < win_type.atoms_len; i++) {
+		for (j = 0; j < LENGTH(types); j++) {
+			if (win_type.atoms[i] == types[j].atom) {
+				name = types[j].name;
+				goto out;
+			}
+		}
+	}
+
+out:
+	xcb_ewmh_get_atoms_reply_wipe(&win_type);
+	return name;
 }
 
 void window_config(xcb_configure_request_event_t *ev)
@@ -29,7 +29,10 @@ xcb_window_t window_create(uint16_t x, uint16_t y, uint16_t width,
 			   uint16_t height);
 void window_show(xcb_window_t win);
 void window_raise(xcb_window_t win);
-void window_center_pointer(xcb_window_t win, int16_t width, int16_t height);
+void window_center_pointer(int16_t x, int16_t y, uint16_t width,
+			   uint16_t height);
+void window_set_normal_state(xcb_window_t win);
+bool window_ignore_enter(xcb_enter_notify_event_t *ev);
 void window_set_focus(xcb_window_t win);
 void window_move(xcb_window_t win, const uint16_t x, const uint16_t y);
 void window_resize(xcb_window_t win, const uint16_t width,
@@ -44,7 +47,10 @@ void window_get_limits_size(xcb_window_t win, uint16_t *max_width,
 			    uint16_t *max_height, uint16_t *min_width,
 			    uint16_t *min_height);
 bool window_hint_us_position(xcb_window_t win);
-bool window_get_pointer(const xcb_window_t *win, int16_t *x, int16_t *y);
+void window_get_name(xcb_window_t win, char *name, uint32_t len);
+void window_get_class(xcb_window_t win, char *class, char *instance,
+		      uint32_t len);
+const char *window_get_type(xcb_window_t win);
 void window_config(xcb_configure_request_event_t *ev);
 void window_delete(xcb_window_t win);
 void window_unmap(xcb_window_t win);
@@ -16,7 +16,12 @@ TEST_OBJ := $(TEST_SRC:.c=.o)
 
 DEPS_SRC := src/utils.c \
             src/conf.c \
-            src/log.c
+            src/list.c \
+            src/log.c \
+            src/timer.c \
+            src/appindex.c \
+            src/rules.c \
+            src/icontheme.c
 DEPS_OBJ := $(patsubst $(SRC_DIR)/%.c, $(TEST_DIR)/%.o, $(DEPS_SRC))
 
 # test target
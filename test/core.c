@@ -17,11 +17,15 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <dirent.h>
+#include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
 #include <libgen.h>
 #include <unistd.h>
+#include <sys/stat.h>
 
 #include "core.h"
 
@@ -189,6 +193,31 @@ void register_test(char *tcase_name, TFun test, char *test_name)
 	}
 }
 
+void remove_tree(const char *path)
+{
+	char child[PATH_MAX];
+	struct dirent *entry;
+	struct stat st;
+	DIR *dir;
+
+	/* links are removed, not followed */
+	if (lstat(path, &st) == 0 && S_ISDIR(st.st_mode)
+	    && (dir = opendir(path)) != NULL) {
+		while ((entry = readdir(dir)) != NULL) {
+			if (strcmp(entry->d_name, ".") == 0
+			    || strcmp(entry->d_name, "..") == 0)
+				continue;
+
+			snprintf(child, sizeof(child), "%s/%s", path,
+				 entry->d_name);
+			remove_tree(child);
+		}
+		closedir(dir);
+	}
+
+	remove(path);
+}
+
 static void init_test(Suite *suite)
 {
 	struct test_case *tcase;
@@ -33,4 +33,7 @@
 
 void register_test(char *tcase, TFun fn, char *test_name);
 
+/* remove the files a test created */
+void remove_tree(const char *path);
+
 #endif
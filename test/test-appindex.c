@@ -0,0 +1,187 @@
+/*
+ * This file is part of the jwm distribution:
+ * https://github.com/JulienMasson/jwm
+ *
+ * Copyright (c) 2018 Julien Masson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "core.h"
+#include "appindex.h"
+#include "timer.h"
+
+static void touch(const char *dir, const char *name, mode_t mode,
+		  const char *content)
+{
+	char path[512];
+	FILE *fp;
+
+	snprintf(path, sizeof(path), "%s/%s", dir, name);
+	fp = fopen(path, "w");
+	fputs(content, fp);
+	fclose(fp);
+	chmod(path, mode);
+}
+
+/* index built from a fake $PATH and XDG data dir */
+static void appindex_setup(char *root)
+{
+	char bin[256], apps[256], data[256], frecency[256];
+
+	fail_unless(mkdtemp(root) != NULL, "Failed to create temp dir");
+	snprintf(bin, sizeof(bin), "%s/bin", root);
+	snprintf(data, sizeof(data), "%s/data", root);
+	snprintf(apps, sizeof(apps), "%s/data/applications", root);
+	snprintf(frecency, sizeof(frecency), "%s/frecency", root);
+	mkdir(bin, 0755);
+	mkdir(data, 0755);
+	mkdir(apps, 0755);
+
+	touch(bin, "foo", 0755, "");
+	touch(bin, "foobar", 0755, "");
+	touch(bin, "barfoo", 0755, "");
+	touch(bin, "notes.txt", 0644, "");
+	touch(apps, "editor.desktop", 0644,
+	      "[Desktop Entry]\nType=Application\nName=Text Editor\n"
+	      "Exec=foo --edit %F\n");
+	touch(apps, "hidden.desktop", 0644,
+	      "[Desktop Entry]\nType=Application\nName=Hidden\n"
+	      "Exec=hidden\nNoDisplay=true\n");
+
+	setenv("PATH", bin, 1);
+	setenv("XDG_DATA_HOME", data, 1);
+	setenv("XDG_DATA_DIRS", root, 1);
+	fail_unless(appindex_init(frecency) == true, "Failed to init index");
+}
+
+/* handle the inotify events and the rebuild they schedule */
+static void appindex_wait(void)
+{
+	unsigned int generation = appindex_generation();
+	struct pollfd pfd = {appindex_get_fd(), POLLIN, 0};
+
+	fail_unless(poll(&pfd, 1, 1000) > 0, "No inotify event");
+	appindex_event();
+
+	pfd.fd = timer_get_fd();
+	while (appindex_generation() == generation) {
+		fail_unless(poll(&pfd, 1, 2000) > 0, "No rebuild");
+		timer_run();
+	}
+}
+
+
+START(appindex_match_kinds)
+{
+	fail_unless(appindex_match("fire", "firefox") == APP_MATCH_PREFIX,
+		    "Should be a prefix match");
+	fail_unless(appindex_match("FOX", "firefox") == APP_MATCH_SUBSTRING,
+		    "Should be a substring match");
+	fail_unless(appindex_match("ffx", "firefox") == APP_MATCH_FUZZY,
+		    "Should be a fuzzy match");
+	fail_unless(appindex_match("xff", "firefox") == APP_MATCH_NONE,
+		    "Shouldn't match");
+}
+END(appindex_match_kinds);
+
+
+START(appindex_query_rank)
+{
+	char root[] = "/tmp/jwm-appindex-XXXXXX";
+	struct app *results[8];
+	int count;
+
+	appindex_setup(root);
+
+	count = appindex_query("foo", results, 8);
+	fail_unless(count == 3, "Wrong number of matches");
+	fail_unless(strcmp(results[0]->name, "foo") == 0, "Wrong first match");
+	fail_unless(strcmp(results[2]->name, "barfoo") == 0,
+		    "Substring should come after prefixes");
+
+	count = appindex_query("text", results, 8);
+	fail_unless(count == 1, "Desktop entry not indexed");
+	fail_unless(strcmp(results[0]->exec, "foo --edit ") == 0,
+		    "Field codes not stripped");
+
+	count = appindex_query("hidden", results, 8);
+	fail_unless(count == 0, "NoDisplay entry indexed");
+
+	count = appindex_query("notes", results, 8);
+	fail_unless(count == 0, "Non executable file indexed");
+
+	appindex_exit();
+	remove_tree(root);
+}
+END(appindex_query_rank);
+
+
+START(appindex_frecency)
+{
+	char root[] = "/tmp/jwm-appindex-XXXXXX";
+	char frecency[256];
+	struct app *results[8];
+
+	appindex_setup(root);
+
+	appindex_query("foob", results, 8);
+	appindex_launched(results[0]);
+
+	appindex_query("foo", results, 8);
+	fail_unless(strcmp(results[0]->name, "foobar") == 0,
+		    "Launched app should rank first");
+	appindex_exit();
+
+	/* history is read back from disk */
+	snprintf(frecency, sizeof(frecency), "%s/frecency", root);
+	appindex_init(frecency);
+	appindex_query("foo", results, 8);
+	fail_unless(strcmp(results[0]->name, "foobar") == 0,
+		    "History not persisted");
+	appindex_exit();
+	remove_tree(root);
+}
+END(appindex_frecency);
+
+
+START(appindex_watch_created_dir)
+{
+	char root[] = "/tmp/jwm-appindex-XXXXXX";
+	char apps[256];
+	struct app *results[8];
+
+	/* $XDG_DATA_DIRS/applications doesn't exist yet */
+	fail_unless(timer_init() == true, "Failed to init timer");
+	appindex_setup(root);
+	snprintf(apps, sizeof(apps), "%s/applications", root);
+
+	mkdir(apps, 0755);
+	appindex_wait();
+	touch(apps, "viewer.desktop", 0644,
+	      "[Desktop Entry]\nType=Application\nName=Viewer\n"
+	      "Exec=viewer\n");
+	appindex_wait();
+	fail_unless(appindex_query("viewer", results, 8) == 1,
+		    "Created dir not watched");
+
+	appindex_exit();
+	timer_exit();
+	remove_tree(root);
+}
+END(appindex_watch_created_dir);
@@ -17,6 +17,8 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <string.h>
+
 #include "core.h"
 #include "conf.h"
 
@@ -39,8 +41,44 @@ END(conf_read_fail2);
 
 START(conf_read_pass)
 {
-	char conf_path[] = ROOT_DIR "/res/.jwmrc";
+	char conf_path[] = ROOT_DIR "/test/jwmrc";
 	conf_init(conf_path);
 	fail_unless(conf_read() == 0, "Cannot read the config");
 }
 END(conf_read_pass);
+
+
+START(conf_read_bindings)
+{
+	char conf_path[] = ROOT_DIR "/test/jwmrc";
+	struct conf_binding *binding;
+
+	conf_init(conf_path);
+	fail_unless(global_conf.keys != NULL, "No key binding read");
+	fail_unless(global_conf.buttons != NULL, "No button binding read");
+
+	binding = global_conf.keys->data;
+	fail_unless(strcmp(binding->combo, "Mod+Return") == 0,
+		    "Wrong key combo");
+	fail_unless(strcmp(binding->action, "start") == 0, "Wrong action");
+	fail_unless(strcmp(binding->arg, "urxvt") == 0, "Wrong argument");
+
+	binding = global_conf.buttons->data;
+	fail_unless(strcmp(binding->arg, "move") == 0, "Wrong argument");
+}
+END(conf_read_bindings);
+
+
+START(conf_read_pools)
+{
+	char conf_path[] = ROOT_DIR "/test/jwmrc";
+	struct conf_pool *pool;
+
+	conf_init(conf_path);
+	fail_unless(global_conf.pools != NULL, "No pool read");
+
+	pool = global_conf.pools->data;
+	fail_unless(pool->size == 1, "Wrong pool size");
+	fail_unless(strcmp(pool->command, "urxvt") == 0, "Wrong command");
+}
+END(conf_read_pools);
@@ -0,0 +1,163 @@
+/*
+ * This file is part of the jwm distribution:
+ * https://github.com/JulienMasson/jwm
+ *
+ * Copyright (c) 2018 Julien Masson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "core.h"
+#include "icontheme.h"
+
+static char root[] = "/tmp/jwm-icontheme-XXXXXX";
+
+static void mkdirs(const char *dir)
+{
+	char path[PATH_MAX], *slash;
+
+	snprintf(path, sizeof(path), "%s/%s", root, dir);
+	for (slash = strchr(path + 1, '/'); slash != NULL;
+	     slash = strchr(slash + 1, '/')) {
+		*slash = '\0';
+		mkdir(path, 0755);
+		*slash = '/';
+	}
+	mkdir(path, 0755);
+}
+
+static void touch(const char *file, const char *content)
+{
+	char path[PATH_MAX];
+	FILE *fp;
+
+	snprintf(path, sizeof(path), "%s/%s", root, file);
+	fp = fopen(path, "w");
+	fputs(content, fp);
+	fclose(fp);
+}
+
+static ino_t cache_inode(void)
+{
+	char path[PATH_MAX];
+	struct stat st;
+
+	snprintf(path, sizeof(path), "%s/cache/jwm/icons-mytheme-24", root);
+	fail_unless(stat(path, &st) == 0, "No cache file");
+	return st.st_ino;
+}
+
+/* mytheme inherits parent, hicolor is the implicit last parent */
+static void icontheme_setup(void)
+{
+	char path[PATH_MAX];
+
+	fail_unless(mkdtemp(root) != NULL, "Failed to create temp dir");
+	mkdirs("cache");
+	mkdirs("icons/mytheme/16x16/apps");
+	mkdirs("icons/mytheme/48x48/apps");
+	mkdirs("icons/parent/24x24/apps");
+	mkdirs("icons/hicolor/24x24/apps");
+
+	touch("icons/mytheme/index.theme",
+	      "[Icon Theme]\nName=My\nInherits=parent\n"
+	      "Directories=16x16/apps,48x48/apps\n\n"
+	      "[16x16/apps]\nSize=16\nType=Fixed\n\n"
+	      "[48x48/apps]\nSize=48\nType=Fixed\n");
+	touch("icons/parent/index.theme",
+	      "[Icon Theme]\nName=Parent\nDirectories=24x24/apps\n\n"
+	      "[24x24/apps]\nSize=24\n");
+	touch("icons/hicolor/index.theme",
+	      "[Icon Theme]\nName=Hicolor\nDirectories=24x24/apps\n\n"
+	      "[24x24/apps]\nSize=24\n");
+
+	touch("icons/mytheme/16x16/apps/term.png", "");
+	touch("icons/mytheme/48x48/apps/term.png", "");
+	touch("icons/mytheme/48x48/apps/editor.png", "");
+	touch("icons/mytheme/48x48/apps/notes.svg", "");
+	touch("icons/parent/24x24/apps/editor.png", "");
+	touch("icons/parent/24x24/apps/viewer.png", "");
+	touch("icons/hicolor/24x24/apps/browser.png", "");
+
+	snprintf(path, sizeof(path), "%s/home", root);
+	setenv("HOME", path, 1);
+	setenv("XDG_DATA_HOME", root, 1);
+	snprintf(path, sizeof(path), "%s/none", root);
+	setenv("XDG_DATA_DIRS", path, 1);
+	snprintf(path, sizeof(path), "%s/cache", root);
+	setenv("XDG_CACHE_HOME", path, 1);
+}
+
+static void check_lookup(const char *name, const char *expected)
+{
+	char path[PATH_MAX], wanted[PATH_MAX];
+
+	snprintf(wanted, sizeof(wanted), "%s/icons/%s", root, expected);
+	fail_unless(icontheme_lookup(name, path, sizeof(path)) == true,
+		    "Icon not found");
+	fail_unless(strcmp(path, wanted) == 0, "Wrong icon path");
+}
+
+
+START(icontheme_lookup_chain)
+{
+	char path[PATH_MAX];
+
+	icontheme_setup();
+	fail_unless(icontheme_init("mytheme", 24) == true, "Init failed");
+
+	/* closest size, then the theme before its parents */
+	check_lookup("term", "mytheme/16x16/apps/term.png");
+	check_lookup("editor", "mytheme/48x48/apps/editor.png");
+	check_lookup("viewer", "parent/24x24/apps/viewer.png");
+	check_lookup("browser", "hicolor/24x24/apps/browser.png");
+
+	fail_unless(icontheme_lookup("notes", path, sizeof(path)) == false,
+		    "Only PNG icons should be indexed");
+	fail_unless(icontheme_lookup("missing", path, sizeof(path)) == false,
+		    "Shouldn't find missing icon");
+
+	icontheme_exit();
+	remove_tree(root);
+}
+END(icontheme_lookup_chain);
+
+
+START(icontheme_cache_reuse)
+{
+	ino_t inode;
+
+	icontheme_setup();
+	fail_unless(icontheme_init("mytheme", 24) == true, "Init failed");
+	inode = cache_inode();
+
+	/* unchanged directories, the cache file is mapped again */
+	fail_unless(icontheme_init("mytheme", 24) == true, "Init failed");
+	fail_unless(cache_inode() == inode, "Cache shouldn't be rebuilt");
+
+	/* a new icon changes the mtime of its directory */
+	touch("icons/parent/24x24/apps/player.png", "");
+	fail_unless(icontheme_init("mytheme", 24) == true, "Init failed");
+	fail_unless(cache_inode() != inode, "Cache should be rebuilt");
+	check_lookup("player", "parent/24x24/apps/player.png");
+
+	icontheme_exit();
+	remove_tree(root);
+}
+END(icontheme_cache_reuse);
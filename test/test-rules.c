@@ -0,0 +1,119 @@
+/*
+ * This file is part of the jwm distribution:
+ * https://github.com/JulienMasson/jwm
+ *
+ * Copyright (c) 2018 Julien Masson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "core.h"
+#include "conf.h"
+#include "rules.h"
+
+static void rules_setup(char *path, const char *content)
+{
+	int fd;
+
+	fd = mkstemp(path);
+	fail_unless(fd != -1, "Failed to create conf");
+	fail_unless(write(fd, content, strlen(content)) != -1,
+		    "Failed to write conf");
+	close(fd);
+
+	/* read once, not needed after */
+	conf_init(path);
+	unlink(path);
+	rules_reload();
+}
+
+
+START(rules_read)
+{
+	char path[] = "/tmp/jwm-rules-XXXXXX";
+	struct conf_rule *rule;
+
+	rules_setup(path, "rule=class=^Firefox$ monitor=2 size=800x600\n"
+			  "rule=title=foo position=10,-20\n"
+			  "rule=class=Firefox\n"
+			  "rule=class=Firefox size=0x10\n"
+			  "rule=colour=red monitor=1\n");
+
+	fail_unless(global_conf.rules != NULL, "No rule read");
+	fail_unless(global_conf.rules->next->next == NULL,
+		    "Invalid rules should be dropped");
+
+	rule = global_conf.rules->data;
+	fail_unless(strcmp(rule->match[RULE_CLASS], "^Firefox$") == 0,
+		    "Wrong class matcher");
+	fail_unless(strcmp(rule->monitor, "2") == 0, "Wrong monitor");
+	fail_unless(rule->width == 800 && rule->height == 600, "Wrong size");
+	fail_unless(rule->position == false, "Position shouldn't be set");
+
+	rule = global_conf.rules->next->data;
+	fail_unless(rule->position && rule->x == 10 && rule->y == -20,
+		    "Wrong position");
+
+	rules_exit();
+}
+END(rules_read);
+
+
+START(rules_first_match)
+{
+	char path[] = "/tmp/jwm-rules-XXXXXX";
+	const char *props[RULE_LAST] = {"Firefox", "Navigator",
+					"Mozilla Firefox", "normal"};
+	const struct conf_rule *rule;
+
+	rules_setup(path, "rule=class=^Fire instance=^dialog$ monitor=1\n"
+			  "rule=class=( monitor=1\n"
+			  "rule=class=fox$ type=^normal$ monitor=2\n"
+			  "rule=title=Firefox monitor=3\n");
+	fail_unless(rules_loaded() == true, "No rule compiled");
+
+	rule = rules_match(props);
+	fail_unless(rule != NULL, "Should match");
+	fail_unless(strcmp(rule->monitor, "2") == 0, "Wrong rule matched");
+
+	props[RULE_TYPE] = "dialog";
+	rule = rules_match(props);
+	fail_unless(strcmp(rule->monitor, "3") == 0, "Wrong rule matched");
+
+	props[RULE_TITLE] = NULL;
+	fail_unless(rules_match(props) == NULL, "Shouldn't match");
+
+	rules_exit();
+	fail_unless(rules_loaded() == false, "Rules not freed");
+}
+END(rules_first_match);
+
+
+START(rules_read_conf)
+{
+	char path[] = ROOT_DIR "/test/jwmrc";
+	struct conf_rule *rule;
+
+	conf_init(path);
+	fail_unless(global_conf.rules != NULL, "No rule read");
+
+	rule = global_conf.rules->data;
+	fail_unless(strcmp(rule->match[RULE_CLASS], "^Pavucontrol$") == 0,
+		    "Wrong class matcher");
+	fail_unless(rule->width == 800 && rule->height == 600, "Wrong size");
+}
+END(rules_read_conf);
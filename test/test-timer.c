@@ -0,0 +1,98 @@
+/*
+ * This file is part of the jwm distribution:
+ * https://github.com/JulienMasson/jwm
+ *
+ * Copyright (c) 2018 Julien Masson.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, version 3.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <poll.h>
+
+#include "core.h"
+#include "timer.h"
+
+static void timer_count(void *data)
+{
+	(*(int *)data)++;
+}
+
+/* wait for the timerfd, then expire what is due */
+static void timer_wait(int timeout_ms)
+{
+	struct pollfd pfd = {timer_get_fd(), POLLIN, 0};
+
+	if (poll(&pfd, 1, timeout_ms) > 0)
+		timer_run();
+}
+
+
+START(timer_oneshot)
+{
+	struct timer timer;
+	int count = 0;
+
+	fail_unless(timer_init() == true, "Failed to init timer");
+	timer_setup(&timer, timer_count, &count);
+	timer_add(&timer, 10, 0);
+	fail_unless(timer_pending(&timer) == true, "Timer should be pending");
+
+	timer_wait(1000);
+	fail_unless(count == 1, "One-shot timer didn't fire once");
+	fail_unless(timer_pending(&timer) == false,
+		    "One-shot timer still pending");
+	timer_exit();
+}
+END(timer_oneshot);
+
+
+START(timer_periodic_cancel)
+{
+	struct timer timer, other;
+	int count = 0, other_count = 0;
+
+	fail_unless(timer_init() == true, "Failed to init timer");
+	timer_setup(&timer, timer_count, &count);
+	timer_setup(&other, timer_count, &other_count);
+	timer_add(&timer, 8, 8);
+	timer_add(&other, 8, 0);
+	timer_cancel(&other);
+
+	while (count < 3)
+		timer_wait(1000);
+
+	fail_unless(other_count == 0, "Cancelled timer fired");
+	fail_unless(timer_pending(&timer) == true,
+		    "Periodic timer not re-armed");
+	timer_cancel(&timer);
+	timer_exit();
+}
+END(timer_periodic_cancel);
+
+
+START(timer_cascade)
+{
+	struct timer timer;
+	int count = 0;
+
+	/* beyond level 0, must cascade down before firing */
+	fail_unless(timer_init() == true, "Failed to init timer");
+	timer_setup(&timer, timer_count, &count);
+	timer_add(&timer, 64 * TIMER_TICK_MS + 20, 0);
+
+	while (timer_pending(&timer))
+		timer_wait(2000);
+	fail_unless(count == 1, "Cascaded timer didn't fire");
+	timer_exit();
+}
+END(timer_cascade);
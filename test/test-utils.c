@@ -17,6 +17,9 @@
  * along with this program. If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <stdio.h>
+#include <string.h>
+
 #include "core.h"
 #include "utils.h"
 
@@ -54,3 +57,58 @@ START(file_in_dir_fail)
 	fail_unless(files == NULL, "Shouldn't access to files in /tatatat");
 }
 END(file_in_dir_fail);
+
+
+START(regex_match_pass)
+{
+	fail_unless(regex_match("cpu0 100 200", "^cpu[0-9]+ ") == true,
+		    "Should match");
+	fail_unless(regex_match("cpu 100 200", "^cpu[0-9]+ ") == false,
+		    "Shouldn't match");
+	fail_unless(regex_match("cpu", "(") == false,
+		    "Invalid pattern shouldn't match");
+}
+END(regex_match_pass);
+
+
+START(regex_search_offsets)
+{
+	const char *line = "MemTotal:       16303548 kB";
+	regmatch_t matches[2];
+
+	fail_unless(regex_search(line, "^([A-Za-z]+): +([0-9]+)", 2, matches)
+			    == true,
+		    "Should match");
+	fail_unless(matches[0].rm_so == 0 && matches[0].rm_eo == 8,
+		    "Wrong offsets of the first group");
+	fail_unless(strncmp(line + matches[1].rm_so, "16303548",
+			    matches[1].rm_eo - matches[1].rm_so)
+			    == 0,
+		    "Wrong offsets of the second group");
+}
+END(regex_search_offsets);
+
+
+START(regex_extract_cached)
+{
+	char pattern[32], value[1][256];
+	int i;
+
+	/* more patterns than cached ones, evicted ones are compiled again */
+	for (i = 0; i < 40; i++) {
+		snprintf(pattern, sizeof(pattern), "^key%d=([a-z]+)$", i % 20);
+		memset(value, '\0', sizeof(value));
+
+		fail_unless(regex_extract("key3=abc", pattern, 1, value)
+				    == (i % 20 == 3),
+			    "Wrong match");
+		if (i % 20 == 3)
+			fail_unless(strcmp(value[0], "abc") == 0,
+				    "Wrong extracted value");
+	}
+
+	regex_cache_clear();
+	fail_unless(regex_match("key3=abc", "^key3") == true,
+		    "Should match after clear");
+}
+END(regex_extract_cached);